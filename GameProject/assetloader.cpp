@@ -0,0 +1,85 @@
+#include "assetloader.h"
+#include "parallel.h"
+
+AssetLoader::AssetLoader(unsigned int threads) : mPending(0), mFailed(false), mStop(false)
+{
+	if (threads == 0)
+		threads = hardwareThreads();
+	for (unsigned int i = 0; i < threads; i++)
+		mWorkers.push_back(std::thread(&AssetLoader::workerLoop, this));
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mJobReady.notify_all();
+	for (size_t i = 0; i < mWorkers.size(); i++)
+		mWorkers[i].join();
+}
+
+void AssetLoader::add(std::function<bool()> work, std::function<void()> upload)
+{
+	Job job;
+	job.work = work;
+	job.upload = upload;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mPending++;
+		mJobs.push_back(job);
+	}
+	mJobReady.notify_one();
+}
+
+void AssetLoader::workerLoop()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mJobReady.wait(lock, [this] { return mStop || !mJobs.empty(); });
+			if (mJobs.empty())
+				return;
+			job = mJobs.front();
+			mJobs.pop_front();
+		}
+
+		bool ok = job.work();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (!ok)
+				mFailed = true;
+			if (ok && job.upload)
+				mUploads.push_back(job.upload);
+			else
+				mPending--;
+		}
+		mUploadReady.notify_one();
+	}
+}
+
+bool AssetLoader::finish()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		mUploadReady.wait(lock, [this] { return mPending == 0 || !mUploads.empty(); });
+		if (mUploads.empty())
+			break;
+		std::function<void()> upload = mUploads.front();
+		mUploads.pop_front();
+
+		//uploads run without the lock, so the loader threads can go on
+		lock.unlock();
+		upload();
+		lock.lock();
+		mPending--;
+	}
+	bool ok = !mFailed;
+	mFailed = false;
+	return ok;
+}
@@ -0,0 +1,308 @@
+#include "clustering.h"
+#include "parallel.h"
+#include <algorithm>
+
+//below this many vertices or triangles per thread the loops stay on one thread
+static const size_t PARALLEL_CLUSTERING_MIN_RANGE = 65536;
+//buckets of the histogram the key partitions are balanced on
+static const uint32_t PARTITION_BUCKETS = 4096;
+
+//radix sort of n pairs, 'keyTemp' and 'valueTemp' hold n entries; the result ends up in keys/values
+static void radixSortRange(CellKey * keys, uint32_t * values, size_t n, CellKey maxKey,
+	CellKey * keyTemp, uint32_t * valueTemp)
+{
+	const unsigned int bits = 11;
+	const size_t buckets = size_t(1) << bits;
+	std::vector<size_t> counts(buckets);
+	bool swapped = false;
+	for (unsigned int shift = 0; shift < 64 && (maxKey >> shift) != 0; shift += bits)
+	{
+		std::fill(counts.begin(), counts.end(), 0);
+		for (size_t i = 0; i < n; i++)
+			counts[(keys[i] >> shift) & (buckets - 1)]++;
+		size_t sum = 0;
+		for (size_t b = 0; b < buckets; b++)
+		{
+			size_t count = counts[b];
+			counts[b] = sum;
+			sum += count;
+		}
+		for (size_t i = 0; i < n; i++)
+		{
+			size_t target = counts[(keys[i] >> shift) & (buckets - 1)]++;
+			keyTemp[target] = keys[i];
+			valueTemp[target] = values[i];
+		}
+		std::swap(keys, keyTemp);
+		std::swap(values, valueTemp);
+		swapped = !swapped;
+	}
+	if (swapped)
+	{
+		std::copy(keys, keys + n, keyTemp);
+		std::copy(values, values + n, valueTemp);
+	}
+}
+
+void radixSortPairs(std::vector<CellKey> & keys, std::vector<uint32_t> & values, CellKey maxKey)
+{
+	std::vector<CellKey> keyTemp(keys.size());
+	std::vector<uint32_t> valueTemp(values.size());
+	radixSortRange(keys.data(), values.data(), keys.size(), maxKey, keyTemp.data(), valueTemp.data());
+}
+
+void clusterVertices(const std::vector<Vertex> & vertices, const Vec3Df & origin, float size, unsigned int r,
+	VertexClusters & clusters, unsigned int threads)
+{
+	if (threads == 0)
+		threads = hardwareThreads();
+	r = clampGridResolution(r);
+	size_t n = vertices.size();
+
+	float cubeLength = size / r;
+	std::vector<CellKey> keys(n);
+	std::vector<CellKey> rangeMax(threads, 0);
+	unsigned int ranges = parallelFor(0, n, [&](size_t first, size_t last, unsigned int range) {
+		CellKey maxKey = 0;
+		for (size_t i = first; i < last; i++)
+		{
+			keys[i] = gridCellKey(vertices[i].p, origin, cubeLength, r);
+			maxKey = std::max(maxKey, keys[i]);
+		}
+		rangeMax[range] = maxKey;
+	}, threads, PARALLEL_CLUSTERING_MIN_RANGE);
+	CellKey maxKey = *std::max_element(rangeMax.begin(), rangeMax.end());
+
+	//Split the key space into one partition per range, balanced on a histogram of the top key
+	//bits. Every cell lies in one partition and the partitions are in key order, so they are
+	//sorted and reduced independently and simply concatenated.
+	unsigned int shift = 0;
+	while ((maxKey >> shift) >= PARTITION_BUCKETS)
+		shift++;
+	size_t buckets = size_t(maxKey >> shift) + 1;
+	std::vector<size_t> rangeHistogram(ranges * buckets, 0);
+	parallelFor(0, n, [&](size_t first, size_t last, unsigned int range) {
+		size_t * histogram = &rangeHistogram[range * buckets];
+		for (size_t i = first; i < last; i++)
+			histogram[keys[i] >> shift]++;
+	}, ranges, PARALLEL_CLUSTERING_MIN_RANGE);
+	std::vector<uint32_t> bucketPartition(buckets);
+	std::vector<CellKey> partitionMax(ranges, 0);
+	size_t seen = 0;
+	for (size_t b = 0; b < buckets; b++)
+	{
+		uint32_t partition = (uint32_t)std::min<size_t>(ranges - 1, seen * ranges / std::max<size_t>(n, 1));
+		bucketPartition[b] = partition;
+		partitionMax[partition] = ((CellKey(b) + 1) << shift) - 1;
+		for (unsigned int t = 0; t < ranges; t++)
+			seen += rangeHistogram[t * buckets + b];
+	}
+
+	//Stable scatter into the partitions: offsets in (partition, range) order, and every range
+	//writes its vertices in index order, so each partition lists its vertices by index.
+	std::vector<size_t> offsets(ranges * ranges, 0);
+	for (unsigned int t = 0; t < ranges; t++)
+	{
+		for (size_t b = 0; b < buckets; b++)
+			offsets[bucketPartition[b] * ranges + t] += rangeHistogram[t * buckets + b];
+	}
+	std::vector<size_t> partitionBegin(ranges + 1, 0);
+	size_t sum = 0;
+	for (unsigned int p = 0; p < ranges; p++)
+	{
+		partitionBegin[p] = sum;
+		for (unsigned int t = 0; t < ranges; t++)
+		{
+			size_t count = offsets[p * ranges + t];
+			offsets[p * ranges + t] = sum;
+			sum += count;
+		}
+	}
+	partitionBegin[ranges] = sum;
+	std::vector<CellKey> sortedKeys(n);
+	std::vector<uint32_t> order(n), orderTemp(n);
+	parallelFor(0, n, [&](size_t first, size_t last, unsigned int range) {
+		std::vector<size_t> target(ranges);
+		for (unsigned int p = 0; p < ranges; p++)
+			target[p] = offsets[p * ranges + range];
+		for (size_t i = first; i < last; i++)
+		{
+			size_t j = target[bucketPartition[keys[i] >> shift]]++;
+			sortedKeys[j] = keys[i];
+			order[j] = (uint32_t)i;
+		}
+	}, ranges, PARALLEL_CLUSTERING_MIN_RANGE);
+
+	//sort every partition and count its cells
+	std::vector<size_t> partitionCells(ranges + 1, 0);
+	parallelFor(0, ranges, [&](size_t first, size_t last, unsigned int) {
+		for (size_t p = first; p < last; p++)
+		{
+			size_t begin = partitionBegin[p], end = partitionBegin[p + 1];
+			radixSortRange(&sortedKeys[begin], &order[begin], end - begin, partitionMax[p], &keys[begin], &orderTemp[begin]);
+			size_t cells = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				if (i == begin || sortedKeys[i] != sortedKeys[i - 1])
+					cells++;
+			}
+			partitionCells[p + 1] = cells;
+		}
+	}, ranges, 1);
+	for (unsigned int p = 0; p < ranges; p++)
+		partitionCells[p + 1] += partitionCells[p];
+
+	//one representative per run of equal keys; each run lists its vertices in index order, so
+	//the sums round exactly like Grid::computeRepresentatives
+	size_t cellCount = partitionCells[ranges];
+	clusters.r = r;
+	clusters.parent = -1;
+	clusters.parentToCluster.clear();
+	clusters.vertexCluster.resize(n);
+	clusters.cellKeys.resize(cellCount);
+	clusters.representatives.resize(cellCount);
+	clusters.sums.resize(cellCount);
+	clusters.counts.resize(cellCount);
+	parallelFor(0, ranges, [&](size_t firstPartition, size_t lastPartition, unsigned int) {
+		for (size_t p = firstPartition; p < lastPartition; p++)
+		{
+			uint32_t cluster = (uint32_t)partitionCells[p];
+			size_t end = partitionBegin[p + 1];
+			for (size_t first = partitionBegin[p]; first < end; cluster++)
+			{
+				Vec3Df sum(0, 0, 0);
+				size_t last = first;
+				for (; last < end && sortedKeys[last] == sortedKeys[first]; last++)
+				{
+					sum = sum + vertices[order[last]].p;
+					clusters.vertexCluster[order[last]] = cluster;
+				}
+				clusters.cellKeys[cluster] = sortedKeys[first];
+				clusters.representatives[cluster] = Vertex(sum / (last - first), Vec3Df(0, 0, 0));
+				clusters.sums[cluster] = sum;
+				clusters.counts[cluster] = (uint32_t)(last - first);
+				first = last;
+			}
+		}
+	}, ranges, 1);
+}
+
+//coarse level from the clusters of a finer one
+static void coarsenClusters(const VertexClusters & fine, unsigned int r, VertexClusters & coarse)
+{
+	//the coarse cell of the center of every fine cell: floor((x + 1/2) * r / fine.r) per axis
+	uint64_t rf = fine.r;
+	size_t count = fine.cellKeys.size();
+	std::vector<CellKey> keys(count);
+	std::vector<uint32_t> order(count);
+	CellKey maxKey = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t x, y, z;
+		mortonCoordinates(fine.cellKeys[i], x, y, z);
+		keys[i] = mortonKey(uint32_t((2 * x + 1) * r / (2 * rf)), uint32_t((2 * y + 1) * r / (2 * rf)),
+			uint32_t((2 * z + 1) * r / (2 * rf)));
+		order[i] = (uint32_t)i;
+		maxKey = std::max(maxKey, keys[i]);
+	}
+	radixSortPairs(keys, order, maxKey);
+
+	coarse.r = r;
+	coarse.cellKeys.clear();
+	coarse.representatives.clear();
+	coarse.sums.clear();
+	coarse.counts.clear();
+	std::vector<uint32_t> & fineToCoarse = coarse.parentToCluster;
+	fineToCoarse.resize(count);
+	for (size_t first = 0; first < count; )
+	{
+		uint32_t cluster = (uint32_t)coarse.cellKeys.size();
+		Vec3Df sum(0, 0, 0);
+		uint32_t vertexCount = 0;
+		size_t last = first;
+		for (; last < count && keys[last] == keys[first]; last++)
+		{
+			sum += fine.sums[order[last]];
+			vertexCount += fine.counts[order[last]];
+			fineToCoarse[order[last]] = cluster;
+		}
+		coarse.cellKeys.push_back(keys[first]);
+		coarse.representatives.push_back(Vertex(sum / vertexCount, Vec3Df(0, 0, 0)));
+		coarse.sums.push_back(sum);
+		coarse.counts.push_back(vertexCount);
+		first = last;
+	}
+
+	coarse.vertexCluster.resize(fine.vertexCluster.size());
+	for (size_t v = 0; v < fine.vertexCluster.size(); v++)
+		coarse.vertexCluster[v] = fineToCoarse[fine.vertexCluster[v]];
+}
+
+void clusterVertexLevels(const std::vector<Vertex> & vertices, const Vec3Df & origin, float size,
+	const std::vector<unsigned int> & resolutions, std::vector<VertexClusters> & levels)
+{
+	levels.resize(resolutions.size());
+	if (resolutions.empty())
+		return;
+
+	//finest first
+	std::vector<size_t> order(resolutions.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return resolutions[a] > resolutions[b]; });
+
+	clusterVertices(vertices, origin, size, resolutions[order[0]], levels[order[0]]);
+	for (size_t i = 1; i < order.size(); i++)
+	{
+		unsigned int r = clampGridResolution(resolutions[order[i]]);
+		//the coarsest finer level whose cells nest in these, else the finest
+		size_t parent = order[0];
+		for (size_t j = 0; j < i; j++)
+		{
+			if (clampGridResolution(resolutions[order[j]]) % r == 0)
+				parent = order[j];
+		}
+		coarsenClusters(levels[parent], r, levels[order[i]]);
+		levels[order[i]].parent = (int)parent;
+	}
+}
+
+void clusterTriangles(const std::vector<Triangle> & triangles, const VertexClusters & clusters,
+	std::vector<Triangle> & clustered, unsigned int threads)
+{
+	remapTriangles(triangles, clusters.vertexCluster, clustered, threads);
+}
+
+static inline bool collapsed(const Triangle & triangle, const std::vector<uint32_t> & map)
+{
+	uint32_t c0 = map[triangle.v[0]];
+	return c0 == map[triangle.v[1]] && c0 == map[triangle.v[2]];
+}
+
+void remapTriangles(const std::vector<Triangle> & triangles, const std::vector<uint32_t> & map,
+	std::vector<Triangle> & remapped, unsigned int threads)
+{
+	//count the surviving triangles of every range, then each range writes its own slice
+	if (threads == 0)
+		threads = hardwareThreads();
+	std::vector<size_t> rangeBegin(threads + 1, 0);
+	unsigned int ranges = parallelFor(0, triangles.size(), [&](size_t first, size_t last, unsigned int range) {
+		size_t count = 0;
+		for (size_t i = first; i < last; i++)
+			count += collapsed(triangles[i], map) ? 0 : 1;
+		rangeBegin[range + 1] = count;
+	}, threads, PARALLEL_CLUSTERING_MIN_RANGE);
+	for (unsigned int t = 0; t < ranges; t++)
+		rangeBegin[t + 1] += rangeBegin[t];
+
+	remapped.resize(rangeBegin[ranges]);
+	parallelFor(0, triangles.size(), [&](size_t first, size_t last, unsigned int range) {
+		size_t j = rangeBegin[range];
+		for (size_t i = first; i < last; i++)
+		{
+			if (collapsed(triangles[i], map))
+				continue;
+			remapped[j++] = Triangle(map[triangles[i].v[0]], map[triangles[i].v[1]], map[triangles[i].v[2]]);
+		}
+	}, ranges, PARALLEL_CLUSTERING_MIN_RANGE);
+}
@@ -1,25 +1,27 @@
 #include "grid.h"
+#include "clustering.h"
+#include "parallel.h"
+#include "meshstream.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <unordered_map>
+#include <float.h>
+#include <stdio.h>
 #include "mesh.h"
 #include <vector>
 #ifdef WIN32
 #include <windows.h>
 #endif
 
-int Grid::isContainedAt(const Vec3Df & pos){
-    //returns index that contains the position
-	float cubeLength = size / r;
-
-	Vec3Df v = pos - origin;
-	int x = v[0] / cubeLength;
-	int y = v[1] / cubeLength;
-	int z = v[2] / cubeLength;
-
-	int indice = x + r * y + r * r*z;
-	return indice;
+CellKey Grid::isContainedAt(const Vec3Df & pos){
+    //returns the key of the cell that contains the position
+	unsigned int cells = clampGridResolution(r);
+	float cubeLength = size / cells;
+	return gridCellKey(pos, origin, cubeLength, cells);
 }
 
 void Grid::addToCell(const Vec3Df & vertexPos) {
-	int nr = isContainedAt(vertexPos);
+	CellKey nr = isContainedAt(vertexPos);
 	std::vector<Vec3Df> list = verticesInCell[nr];
 	list.push_back(vertexPos);
 	verticesInCell[nr] = list;
@@ -33,12 +35,14 @@ void Grid::putVertices(const std::vector<Vertex> & vertices){
 }
 
 void Grid::computeRepresentatives() {
-	for (int i = 0; i < r*r*r; i++) {
-		std::vector<Vec3Df> list = verticesInCell[i];
+	//only the occupied cells, the keys do not enumerate as 0 .. r^3 - 1
+	for (CellContent::iterator cell = verticesInCell.begin(); cell != verticesInCell.end(); ++cell) {
+		CellKey i = cell->first;
+		const std::vector<Vec3Df> & list = cell->second;
 		if (list.size() > 0) {
 			Vec3Df p = Vec3Df(0, 0, 0);
 			Vec3Df n = Vec3Df(0, 0, 0);
-			for (std::vector<Vec3Df>::iterator it = list.begin(); it != list.end(); ++it) {
+			for (std::vector<Vec3Df>::const_iterator it = list.begin(); it != list.end(); ++it) {
 				p = p + *it;
 			}
 			p = p / list.size();
@@ -126,7 +130,198 @@ void Grid::computeRepresentatives() {
 //    glPopAttrib();
 //}
 
-Mesh Grid::simplifyMesh(Mesh mesh, unsigned int r) {
+/************************************************************
+ * Simplification by vertex clustering (see clustering.h)
+ ************************************************************/
+//the grid covers the bounding box of the mesh, with a small margin
+static Grid simplificationGrid(const Vec3Df & bbOrigin, float bbEdgeSize, unsigned int r) {
+	double offset = 0.01;
+	Vec3Df vecOffset = Vec3Df(offset, offset, offset);
+	return Grid(bbOrigin - vecOffset, bbEdgeSize + 2 * offset, r);
+}
+
+static Grid simplificationGrid(const Mesh & mesh, unsigned int r) {
+	return simplificationGrid(mesh.bbOrigin, mesh.bbEdgeSize, r);
+}
+
+Mesh Grid::simplifyMesh(const Mesh & mesh, unsigned int r, unsigned int threads) {
+	Mesh simplified = clusterMesh(mesh, r, threads);
+	simplified.centerNormalsAndBounds();
+	return simplified;
+}
+
+Mesh Grid::clusterMesh(const Mesh & mesh, unsigned int r, unsigned int threads) {
+	Grid grid = simplificationGrid(mesh, r);
+
+	//one vertex per occupied cell, in cell order; vertexCluster is the flat old -> new index map
+	VertexClusters clusters;
+	clusterVertices(mesh.vertices, grid.origin, grid.size, r, clusters, threads);
+
+	std::vector<Triangle> simplifiedTriangles;
+	clusterTriangles(mesh.triangles, clusters, simplifiedTriangles, threads);
+
+	return Mesh(clusters.representatives, simplifiedTriangles);
+}
+
+void Grid::simplifyMeshLevels(const Mesh & mesh, const std::vector<unsigned int> & resolutions, std::vector<MeshSoA> & levels) {
+	Grid grid = simplificationGrid(mesh, 1);
+	std::vector<VertexClusters> clusters;
+	clusterVertexLevels(mesh.vertices, grid.origin, grid.size, resolutions, clusters);
+
+	//triangles finest first, every level from the (already reduced) list of its parent
+	std::vector<size_t> order(resolutions.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return resolutions[a] > resolutions[b]; });
+	std::vector<std::vector<Triangle> > triangles(resolutions.size());
+	for (size_t k = 0; k < order.size(); k++) {
+		const VertexClusters & level = clusters[order[k]];
+		if (level.parent < 0)
+			clusterTriangles(mesh.triangles, level, triangles[order[k]]);
+		else
+			remapTriangles(triangles[level.parent], level.parentToCluster, triangles[order[k]]);
+	}
+
+	levels.resize(resolutions.size());
+	parallelFor(0, levels.size(), [&](size_t first, size_t last, unsigned int) {
+		for (size_t i = first; i < last; i++) {
+			MeshSoA & level = levels[i];
+			const std::vector<Vertex> & representatives = clusters[i].representatives;
+			level.resize(representatives.size());
+			for (size_t v = 0; v < representatives.size(); v++) {
+				level.px[v] = representatives[v].p[0];
+				level.py[v] = representatives[v].p[1];
+				level.pz[v] = representatives[v].p[2];
+			}
+			level.triangles.resize(triangles[i].size());
+			for (size_t t = 0; t < triangles[i].size(); t++) {
+				for (int j = 0; j < 3; j++)
+					level.triangles[t].v[j] = triangles[i][t].v[j];
+			}
+			//as Mesh::centerNormalsAndBounds
+			level.centerAndScaleToUnit();
+			level.computeVertexNormals();
+			level.computeBoundingCube();
+		}
+	}, 0, 1);
+}
+
+std::vector<Mesh> Grid::simplifyMeshLevels(const Mesh & mesh, const std::vector<unsigned int> & resolutions) {
+	std::vector<MeshSoA> levels;
+	simplifyMeshLevels(mesh, resolutions, levels);
+	std::vector<Mesh> meshes(levels.size());
+	for (size_t i = 0; i < levels.size(); i++)
+		levels[i].toMesh(meshes[i]);
+	return meshes;
+}
+
+//simplifyMesh for a file read in pieces: bounds, cell sums and triangles in three passes
+bool Grid::simplifyMeshStreaming(const char * filename, unsigned int r, Mesh & simplified, size_t chunkSize) {
+	if (r < 1 || r > MAX_GRID_RESOLUTION)
+		return false;
+	MeshStream stream;
+	if (!stream.open(filename, chunkSize))
+		return false;
+
+	//pass 1: bounding cube, as Mesh::computeBoundingCube
+	float minPoint[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maxPoint[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	size_t vertexCount = 0;
+	bool ok = stream.readPositions([&](const float * xyz, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			for (int k = 0; k < 3; k++) {
+				minPoint[k] = std::min(minPoint[k], xyz[3 * i + k]);
+				maxPoint[k] = std::max(maxPoint[k], xyz[3 * i + k]);
+			}
+		}
+		vertexCount += count;
+		return true;
+	});
+	if (!ok)
+		return false;
+	if (vertexCount == 0) {
+		for (int k = 0; k < 3; k++)
+			minPoint[k] = maxPoint[k] = 0.0f;
+	}
+	Vec3Df bbOrigin(minPoint[0], minPoint[1], minPoint[2]);
+	float bbEdgeSize = std::max(std::max(maxPoint[0] - minPoint[0], maxPoint[1] - minPoint[1]), maxPoint[2] - minPoint[2]);
+	Grid grid = simplificationGrid(bbOrigin, bbEdgeSize, r);
+	float cubeLength = grid.size / r;
+
+	//pass 2: position sums of the occupied cells, in file order like clusterVertices. The cell
+	//slot of every vertex goes to an anonymous temporary file instead of memory: removed when
+	//closed, never next to the source (which may be read-only or simplified by another run).
+	FILE * scratch = tmpfile();
+	if (!scratch)
+		return false;
+	std::unordered_map<CellKey, uint32_t> cellSlot;
+	std::vector<CellKey> slotKeys;
+	std::vector<uint32_t> slotCounts, slots;
+	std::vector<Vec3Df> slotSums;
+	ok = stream.readPositions([&](const float * xyz, size_t count) {
+		slots.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			Vec3Df p(xyz[3 * i], xyz[3 * i + 1], xyz[3 * i + 2]);
+			CellKey key = gridCellKey(p, grid.origin, cubeLength, r);
+			std::pair<std::unordered_map<CellKey, uint32_t>::iterator, bool> cell =
+				cellSlot.insert(std::make_pair(key, (uint32_t)slotKeys.size()));
+			if (cell.second) {
+				slotKeys.push_back(key);
+				slotSums.push_back(Vec3Df(0, 0, 0));
+				slotCounts.push_back(0);
+			}
+			uint32_t slot = cell.first->second;
+			slotSums[slot] = slotSums[slot] + p;
+			slotCounts[slot]++;
+			slots[i] = slot;
+		}
+		return fwrite(slots.data(), sizeof(uint32_t), count, scratch) == count;
+	});
+	cellSlot.clear();
+
+	//clusters in ascending cell order, as clusterVertices numbers them
+	std::vector<uint32_t> order(slotKeys.size()), slotCluster(slotKeys.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = (uint32_t)i;
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return slotKeys[a] < slotKeys[b]; });
+	std::vector<Vertex> representatives(order.size());
+	for (size_t c = 0; c < order.size(); c++) {
+		slotCluster[order[c]] = (uint32_t)c;
+		representatives[c] = Vertex(slotSums[order[c]] / slotCounts[order[c]], Vec3Df(0, 0, 0));
+	}
+
+	//pass 3: triangles between the clusters, through the mapped scratch file
+	std::vector<Triangle> triangles;
+	MappedFile vertexSlots;
+	ok = ok && vertexSlots.open(scratch) && vertexSlots.size() == vertexCount * sizeof(uint32_t);
+	fclose(scratch);
+	if (ok) {
+		const uint32_t * vertexSlot = reinterpret_cast<const uint32_t *>(vertexSlots.data());
+		ok = stream.readTriangles([&](const uint32_t * indices, size_t count) {
+			for (size_t t = 0; t < count; t++) {
+				const uint32_t * v = indices + 3 * t;
+				if (v[0] >= vertexCount || v[1] >= vertexCount || v[2] >= vertexCount)
+					continue;
+				uint32_t c0 = slotCluster[vertexSlot[v[0]]];
+				uint32_t c1 = slotCluster[vertexSlot[v[1]]];
+				uint32_t c2 = slotCluster[vertexSlot[v[2]]];
+				if (c0 == c1 && c0 == c2)
+					continue;
+				triangles.push_back(Triangle(c0, c1, c2));
+			}
+			return true;
+		});
+	}
+	vertexSlots.close();
+	if (!ok)
+		return false;
+
+	simplified = Mesh(representatives, triangles);
+	simplified.centerNormalsAndBounds();
+	return true;
+}
+
+//original implementation with a std::map per cell, kept as reference for tools/gridbench
+Mesh Grid::simplifyMeshLegacy(const Mesh & mesh, unsigned int r) {
 	//Create a grid that covers the bounding box of the mesh. 
 	//Be thorough and check all functions, as some of the calls below might NOT directly work and need to be written by you.
 	//It should be considered a guideline, NOT the solution.
@@ -147,7 +342,7 @@ Mesh Grid::simplifyMesh(Mesh mesh, unsigned int r) {
 
 	// //Create a new list of vertices for the simplified model
 	// //What is the effect of the code below?
-	std::map<unsigned int, unsigned int > newIndexRemapping;
+	std::map<CellKey, unsigned int > newIndexRemapping;
 	std::vector<Vertex> simplifiedVertices;
 
 	int count = 0;
@@ -163,9 +358,9 @@ Mesh Grid::simplifyMesh(Mesh mesh, unsigned int r) {
 	std::vector<Triangle> simplifiedTriangles;
 	for (int i = 0; i < triangles.size(); i++) {
 		Triangle tr = triangles[i];
-		int indice1 = grid.isContainedAt(vertices[tr.v[0]].p);
-		int indice2 = grid.isContainedAt(vertices[tr.v[1]].p);
-		int indice3 = grid.isContainedAt(vertices[tr.v[2]].p);
+		CellKey indice1 = grid.isContainedAt(vertices[tr.v[0]].p);
+		CellKey indice2 = grid.isContainedAt(vertices[tr.v[1]].p);
+		CellKey indice3 = grid.isContainedAt(vertices[tr.v[2]].p);
 
 		if (indice1 == indice2 && indice1 == indice3) {
 			continue;
@@ -181,9 +376,7 @@ Mesh Grid::simplifyMesh(Mesh mesh, unsigned int r) {
 	Mesh simplified = Mesh(simplifiedVertices, simplifiedTriangles);
 
 	// //recalculate the normals.
-	simplified.centerAndScaleToUnit();
-	simplified.computeVertexNormals();
-	simplified.computeBoundingCube();
+	simplified.centerNormalsAndBounds();
 	return simplified;
 }
 
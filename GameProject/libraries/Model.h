@@ -1,6 +1,11 @@
 #include <vector>
-#include <glm/gtx/intersect.hpp>
+#include <algorithm>
+#include <stdint.h>
+#include <cfloat>
 #include <glm/gtx/vector_angle.hpp>
+#include "ModelVertex.h"
+#include "lodchain.h"
+#include "terraingenerator.h"
 
 enum StateType
 {
@@ -26,38 +31,99 @@ struct MixFactor
 	float increment = 0.01;
 };
 
-struct VertexBasic {
-	glm::vec3 pos;
-	glm::vec3 normal;
-	glm::vec2 texCoor;
-};
-struct terrainVertex :VertexBasic
-{
-	glm::vec3 shadow;
-};
-struct EnemyVertex :VertexBasic {
-	glm::vec3 pos_idle;
-	glm::vec3 normal_idle;
-	glm::vec3 pos_dead;
-	glm::vec3 normal_dead;
-};
-struct AniviaVertex :VertexBasic
+// Element (index) buffer of a vertex array object
+// indices are stored as 16 bit whenever all vertices can be addressed with them
+struct ElementBuffer
 {
-	glm::vec3 pos_idle;
-	glm::vec3 normal_idle;
-	glm::vec3 pos_attack;
-	glm::vec3 normal_attack;
-	glm::vec3 pos_dead;
-	glm::vec3 normal_dead;
-};
+	GLuint id = 0;
+	GLenum type = GL_UNSIGNED_INT;
+	GLsizei count = 0;
+
+	// create the buffer and attach it to the currently bound vertex array object
+	void load(const std::vector<uint32_t> &indices, size_t vertexCount)
+	{
+		type = vertexCount <= 0xffff ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		count = GLsizei(indices.size());
+		glGenBuffers(1, &id);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
+		if (type == GL_UNSIGNED_SHORT)
+		{
+			std::vector<uint16_t> narrow(indices.begin(), indices.end());
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrow.size() * sizeof(uint16_t), narrow.data(), GL_STATIC_DRAW);
+		}
+		else
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+	}
+
+	// replace the start of the buffer, keeps the index type chosen by load()
+	void update(GLuint vao, const std::vector<uint32_t> &indices)
+	{
+		count = GLsizei(indices.size());
+		glBindVertexArray(vao);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
+		if (type == GL_UNSIGNED_SHORT)
+		{
+			std::vector<uint16_t> narrow(indices.begin(), indices.end());
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, narrow.size() * sizeof(uint16_t), narrow.data());
+		}
+		else
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(uint32_t), indices.data());
+	}
+
+	// draw the triangles, the vertex array object must be bound
+	void draw() const
+	{
+		glDrawElements(GL_TRIANGLES, count, type, reinterpret_cast<void*>(0));
+	}
+
+	// draw 'indexCount' indices starting at index 'first'
+	void draw(uint32_t first, uint32_t indexCount) const
+	{
+		size_t indexSize = type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+		glDrawElements(GL_TRIANGLES, GLsizei(indexCount), type, reinterpret_cast<void*>(first * indexSize));
+	}
 
-struct BossVertex :VertexBasic {
-	glm::vec3 pos_idle;
-	glm::vec3 normal_idle;
-	glm::vec3 pos_attack;
-	glm::vec3 normal_attack;
+	// draw one level of a LOD chain stored in this buffer, the whole buffer without a chain
+	void draw(const LodChain &chain, int level, LodStats *stats = nullptr) const
+	{
+		if (chain.levels.empty())
+		{
+			draw();
+			if (stats)
+			{
+				stats->fullTriangles += count / 3;
+				stats->drawnTriangles += count / 3;
+			}
+			return;
+		}
+		const LodLevel &range = chain.levels[level];
+		draw(range.firstIndex, range.indexCount);
+		if (stats)
+		{
+			stats->fullTriangles += chain.triangles(0);
+			stats->drawnTriangles += chain.triangles(level);
+		}
+	}
 };
 
+// radius in pixels of a sphere on a viewport 'viewportHeight' pixels high,
+// infinite when the sphere reaches the camera or is behind it
+inline float projectedSphereRadius(const Camera &camera, glm::vec3 center, float radius, float viewportHeight)
+{
+	float distance = glm::dot(center - camera.position, glm::normalize(camera.forward));
+	if (distance <= radius)
+		return FLT_MAX;
+	return radius * viewportHeight / (2.0f * distance * tan(camera.fov * 0.5f));
+}
+
+// level of 'chain' for a model at 'center' drawn with 'scale', given the level drawn last frame
+inline int updateLodLevel(const LodChain &chain, int current, const Camera &camera, glm::vec3 center, float scale, float viewportHeight)
+{
+	if (chain.levels.size() <= 1)
+		return 0;
+	return selectLodLevel(chain, projectedSphereRadius(camera, center, chain.radius * scale, viewportHeight), current);
+}
+
 class Model
 {	
 public:
@@ -67,14 +133,35 @@ public:
 	glm::vec2 screenCoor = { 0,0 };
 	float rotateAngle = 0.0;
 	float scaleFactor = 1.0;
-	GLuint texture;
-	int textureNumber;
-	GLuint vao, vbo;
+	GLuint texture = 0;
+	int textureNumber = 0;
+	// 0 until uploaded, so a model whose upload never ran draws nothing
+	GLuint vao = 0, vbo = 0;
+	ElementBuffer ebo;
+	std::vector<uint32_t> indices; // triangle list into the vertices of the derived class
+	LodChain lod;     // simplified levels appended to the vertices and indices (see lodchain.h)
+	int lodLevel = 0; // level drawn by drawLod()
+	// decoded texture waiting for uploadTexture()
+	stbi_uc* pixels = nullptr;
+	int width = 0, height = 0;
+
 	void loadTexture(char* fileName)
 	{
-		int width, height, channels;
-		stbi_uc* pixels = stbi_load(fileName, &width, &height, &channels, 3);
+		decodeTexture(fileName);
+		uploadTexture();
+	}
+
+	// decode the image only, no GL calls: can run on a loader thread
+	bool decodeTexture(const char* fileName)
+	{
+		int channels;
+		pixels = stbi_load(fileName, &width, &height, &channels, 3);
+		return pixels != nullptr;
+	}
 
+	// create the texture from the decoded image (main thread)
+	void uploadTexture()
+	{
 		// Create Texture
 
 		glGenTextures(1, &texture);
@@ -99,6 +186,38 @@ public:
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		textureNumber = textureCount++;
+
+		stbi_image_free(pixels);
+		pixels = nullptr;
+	}
+
+	// use the texture of another model loaded from the same image
+	void shareTexture(const Model &other)
+	{
+		texture = other.texture;
+		textureNumber = other.textureNumber;
+	}
+
+	// use all GPU data (buffers and texture) of another instance of the same model
+	void shareGpuData(const Model &other)
+	{
+		vao = other.vao;
+		vbo = other.vbo;
+		ebo = other.ebo;
+		lod = other.lod;
+		shareTexture(other);
+	}
+
+	// pick the level of detail for this frame from the screen size of the model
+	void updateLod(const Camera &camera, float viewportHeight)
+	{
+		lodLevel = updateLodLevel(lod, lodLevel, camera, position, scaleFactor, viewportHeight);
+	}
+
+	// draw the current level, the vertex array object must be bound
+	void drawLod(LodStats *stats = nullptr) const
+	{
+		ebo.draw(lod, lodLevel, stats);
 	}
 	void passUniform(GLuint program)
 	{
@@ -217,9 +336,14 @@ class Boss : public Character
 {
 public:
 	std::vector<BossVertex> vertices;
-	GLuint vao_tex, vbo_tex;
+	GLuint vao_tex = 0, vbo_tex = 0;
+	ElementBuffer ebo_tex;
 	std::vector<BossVertex> texturedVertices;
-	std::vector<std::vector<BossVertex>> simplifiedVertices;
+	std::vector<uint32_t> texturedIndices;
+	LodChain texturedLod;     // levels of the textured mesh in vbo_tex/ebo_tex
+	int texturedLodLevel = 0;
+	LodChain damageLod;   // ranges of the damage levels in vbo/ebo (see lodasset.h)
+	int damageLevel = 0;  // level drawn for the current state
 	void passUniform(GLuint program, bool uniColor = true, bool onlyWings = false, bool onlyBody = false, bool passMixFactor = false)
 	{
 		Model::passUniform(program);
@@ -237,21 +361,31 @@ public:
 	}
 	void update()
 	{
+		int level = -1;
 		switch (state)
 		{
 		case IDLE:
-			vertices = simplifiedVertices[0];
+			level = 0;
 			break;
 		case DAMAGE1:
-			vertices = simplifiedVertices[1];
+			level = 1;
 			break;
 		case DAMAGE2:
-			vertices = simplifiedVertices[4];
+			level = 4;
 			break;
 		case DAMAGE3:
-			vertices = simplifiedVertices[5];
+			level = 5;
 			break;
 		}
+		if (level >= 0 && level < int(damageLod.levels.size()))
+			damageLevel = level;
+	}
+
+	// the CPU copies of the damage levels are not needed once they are uploaded
+	void releaseDamageLevels()
+	{
+		std::vector<BossVertex>().swap(vertices);
+		std::vector<uint32_t>().swap(indices);
 	}
 };
 
@@ -259,10 +393,18 @@ class Terrain: public Model
 {
 public:
 	int NbVertX, NbVertY;
-	int startingRow = 0; //draw from this row
-	std::vector <std::vector<terrainVertex>> grid;
+	int startingRow = 0; //draw from this strip
+	int firstRow = 0; //row of the terrain at the front strip, rows count on forever as the terrain scrolls
+	// makes the rows on a worker thread, a chunk of chunkRows rows at a time (see terraingenerator.h)
+	std::unique_ptr<TerrainGenerator> generator;
+	int chunkRows = 64;
+	uint32_t seed = 1;
+	glm::vec3 lightDir;
 	float updateInterval = 1.0;
+	// one vertex per grid point: the NbVertY + 1 rows on screen, row i at (i % (NbVertY + 1)) * NbVertX
 	std::vector <terrainVertex> vertices;
+	// vertices takeRow() changed since the last uploadChanges(): first vertex, count
+	std::vector<std::pair<size_t, size_t>> changedVertices;
 	double lastUpdateTime = 0;
 	double lastFrameTime = 0;
 	Terrain(int NbVertX, int NbVertY, glm::vec3 lightDir)
@@ -274,31 +416,17 @@ public:
 		this->NbVertY = NbVertY;
 		lastUpdateTime = glfwGetTime();
 		lastFrameTime = lastUpdateTime;
-		generateTerrain(lightDir);
+		this->lightDir = lightDir;
 	}
-	void generateTerrain(glm::vec3 lightDir)
+	// Starts the generator and takes the rows on screen; not done by the constructor so that a global
+	// terrain starts no thread before main()
+	void generateTerrain()
 	{
-		// i - row; j - column
-		for (int i = 0; i < NbVertY; i++)
-		{
-			std::vector<terrainVertex> row;
-			for (int j = 0; j < NbVertX; j++)
-			{
-				terrainVertex vertex;
-				float height;
-				height = static_cast <float> (rand()) / static_cast <float> (RAND_MAX);
-				//height = abs(sin(i*j));
-				vertex.pos = { j, height, i};
-				vertex.texCoor = { j / float(NbVertX), i / float(NbVertY) };
-				vertex.normal = { 0,0,0 };
-				vertex.shadow = { 1,1,1 };
-				row.push_back(vertex);
-			}
-			grid.push_back(row);
-		}
-		calculateNormals();
-
-		computeShadow(lightDir);
+		TerrainSettings settings = { NbVertX, chunkRows, seed, lightDir };
+		generator.reset(new TerrainGenerator(settings));
+		vertices.resize(size_t(NbVertY + 1) * NbVertX);
+		for (int i = 0; i <= NbVertY; i++)
+			takeRow(i);
 		generateTriangles();
 	}
 	void passUniform(GLuint program)
@@ -308,134 +436,61 @@ public:
 		glUniform1f(glGetUniformLocation(program, "useShadow"), true);
 	}
 
-	void calculateNormals()
+	// Puts the next row of the generator, row i with its normals and shadows, behind the others
+	// (in its slot of vertices, over the row that left at the front)
+	void takeRow(int i)
 	{
-		for (int i = 0; i < NbVertY; i++)
-		{
-			for (int j = 0; j < NbVertX - 1; j++)
-			{
-				VertexBasic *vertex_1, *vertex_2, *vertex_3, *vertex_4;
-				vertex_1 = &grid[i][j];
-				vertex_2 = &grid[i][j + 1];
-
-				if (i == NbVertY - 1)
-				{
-					vertex_3 = &grid[0][j + 1];
-					vertex_4 = &grid[0][j];
-				}
-				else
-				{
-					vertex_3 = &grid[(i + 1)][j + 1];
-					vertex_4 = &grid[(i + 1)][j];
-				}
-
-				glm::vec3 normal_1, normal_2;
-				normal_1 = glm::triangleNormal(vertex_1->pos, vertex_2->pos, vertex_3->pos);
-				normal_2 = glm::triangleNormal(vertex_3->pos, vertex_4->pos, vertex_1->pos);
-
-				vertex_1->normal += normal_1;
-				vertex_2->normal += normal_1;
-				vertex_3->normal += normal_1;
-				
-				vertex_3->normal = normal_2;
-				vertex_4->normal = normal_2;
-				vertex_1->normal = normal_2;
-			}
-		}
+		const terrainVertex * source = generator->nextRow();
+		size_t first = size_t(i % (NbVertY + 1)) * NbVertX;
+		std::copy(source, source + NbVertX, vertices.begin() + first);
+		// the texture repeats every NbVertY rows (GL_REPEAT)
+		for (int j = 0; j < NbVertX; j++)
+			vertices[first + j].texCoor.y = i / float(NbVertY);
+		changedVertices.push_back(std::make_pair(first, size_t(NbVertX)));
 	}
 
+	// One strip of quads per slot of vertices, between that row and the one in the next slot. The
+	// rows keep their slot while the terrain scrolls, so the indices never change; only the strip
+	// from the last row back to the first one is not drawn (see draw()).
 	void generateTriangles()
 	{
-		for (int i = 0; i < NbVertY; i++)
+		int slots = NbVertY + 1;
+		for (int strip = 0; strip < slots; strip++)
 		{
+			uint32_t first = uint32_t(strip * NbVertX);
+			uint32_t next = uint32_t(((strip + 1) % slots) * NbVertX);
 			for (int j = 0; j < NbVertX - 1; j++)
 			{
-				terrainVertex vertex_1, vertex_2, vertex_3, vertex_4;
-				vertex_1 = grid[i][j];
-				vertex_2 = grid[i][j + 1];
-
-				if (i == NbVertY - 1)
-				{
-					vertex_3 = grid[0][j + 1];
-					vertex_4 = grid[0][j];
-					vertex_3.pos.z += NbVertY;
-					vertex_4.pos.z += NbVertY;
-					vertex_3.texCoor.y = 1.0;
-					vertex_4.texCoor.y = 1.0;
-				}
-				else
-				{
-					vertex_3 = grid[(i + 1)][j + 1];
-					vertex_4 = grid[(i + 1)][j];
-				}
-
-				vertex_1.normal = glm::normalize(vertex_1.normal);
-				vertex_2.normal = glm::normalize(vertex_2.normal);
-				vertex_3.normal = glm::normalize(vertex_3.normal);
-				vertex_4.normal = glm::normalize(vertex_4.normal);
-
-				vertices.push_back(vertex_1);
-				vertices.push_back(vertex_2);
-				vertices.push_back(vertex_3);
-
-				vertices.push_back(vertex_3);
-				vertices.push_back(vertex_4);
-				vertices.push_back(vertex_1);
+				uint32_t vertex_1, vertex_2, vertex_3, vertex_4;
+				vertex_1 = first + j;
+				vertex_2 = first + j + 1;
+				vertex_3 = next + j + 1;
+				vertex_4 = next + j;
+
+				indices.push_back(vertex_1);
+				indices.push_back(vertex_2);
+				indices.push_back(vertex_3);
+
+				indices.push_back(vertex_3);
+				indices.push_back(vertex_4);
+				indices.push_back(vertex_1);
 			}
 		}
+		// all of vertices goes to the GPU with the buffer
+		changedVertices.clear();
 	}
 
-	void computeShadow(glm::vec3 lightDir)
+	// draws the NbVertY strips from startingRow on, the vertex array object must be bound: one
+	// draw call, two when they wrap around the end of the index buffer
+	void draw() const
 	{
-		// i - row; j - column
-		for (int i = 0; i < NbVertY; i++)
-		{
-			for (int j = 0; j < NbVertX; j++)
-			{
-				bool inShadow = false;
-				terrainVertex vertex = grid[i][j];
-				for (int ii = 0; ii < NbVertY; ii++)
-				{
-					for (int jj = 0; jj < NbVertX - 1; jj++)
-					{
-						terrainVertex vertex_1, vertex_2, vertex_3, vertex_4;
-						vertex_1 = grid[(i + ii) % NbVertY][jj];
-						vertex_2 = grid[(i + ii) % NbVertY][jj+ 1];
-						vertex_3 = grid[(i + ii + 1) % NbVertY][jj + 1];
-						vertex_4 = grid[(i + ii + 1) % NbVertY][jj];
-						
-						if (ii == 0 && jj == j || ii == 0 && jj + 1 == j || ii + 1 == 0 && jj == j || ii + 1 == 0 && jj + 1 == j)
-							continue;
-
-						if (i + ii >= NbVertY)
-						{
-							vertex_1.pos.z += NbVertY;
-							vertex_2.pos.z += NbVertY;
-							vertex_3.pos.z += NbVertY;
-							vertex_4.pos.z += NbVertY;
-						}
-
-						glm::vec3 baryPosition;
-						inShadow = glm::intersectRayTriangle(vertex.pos, -lightDir, vertex_1.pos, vertex_2.pos, vertex_3.pos, baryPosition);
-						if (inShadow == true)
-							break;
-						inShadow = glm::intersectRayTriangle(vertex.pos, -lightDir, vertex_3.pos, vertex_4.pos, vertex_1.pos, baryPosition);
-						if (inShadow == true)
-							break;
-					}
-					if (inShadow == true)
-						break;
-				}
-				if (inShadow == true)
-				{
-					grid[i][j].shadow = { 0.5,0.5,0.5 };
-				}
-					
-			}
-		}
+		uint32_t stripIndices = uint32_t(6 * (NbVertX - 1));
+		uint32_t slots = uint32_t(NbVertY + 1), start = uint32_t(startingRow);
+		ebo.draw(start * stripIndices, std::min(slots - start, uint32_t(NbVertY)) * stripIndices);
+		if (start > 1)
+			ebo.draw(0, (start - 1) * stripIndices);
 	}
 
-
 	void update()
 	{
 		double currentTime = glfwGetTime();
@@ -445,13 +500,37 @@ public:
 		if (currentTime - lastUpdateTime < updateInterval)
 			return;
 		lastUpdateTime = currentTime;
-		int startingIndex = 2 * 3 * (NbVertX - 1) * startingRow;
-		for (int i = 0; i < 2 * 3 * (NbVertX - 1); i++)
+		// the front row leaves, behind the last one a new row that comes finished from the
+		// generator: NbVertX vertices to copy whatever NbVertY and the chunk size are
+		takeRow(firstRow + NbVertY + 1);
+		firstRow++;
+		startingRow = firstRow % (NbVertY + 1);
+	}
+
+	// Sends the vertices update() changed to vbo, nothing on the frames in between: one row per
+	// scroll step, a single glBufferSubData. The scrolling itself is only the position uniform.
+	void uploadChanges()
+	{
+		if (changedVertices.empty())
+			return;
+		std::sort(changedVertices.begin(), changedVertices.end());
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		size_t first = changedVertices[0].first, end = first;
+		for (size_t k = 0; k <= changedVertices.size(); k++)
 		{
-			vertices[startingIndex + i].pos.z += NbVertY;
+			if (k < changedVertices.size() && changedVertices[k].first <= end)
+			{
+				end = std::max(end, changedVertices[k].first + changedVertices[k].second);
+				continue;
+			}
+			glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(terrainVertex), (end - first) * sizeof(terrainVertex), &vertices[first]);
+			if (k < changedVertices.size())
+			{
+				first = changedVertices[k].first;
+				end = first + changedVertices[k].second;
+			}
 		}
-		startingRow++;
-		startingRow %= NbVertY;
+		changedVertices.clear();
 	}
 };
 
@@ -460,7 +539,6 @@ class Shape : public Model
 {
 public:
 	std::vector<VertexBasic> points;
-	std::vector<int> indices;
 	float radius = 1;
 	glm::vec3 offset = { 0,0,0 };
 	StateType state = WAITING;
@@ -532,16 +610,6 @@ public:
 		}
 	}
 
-	std::vector<VertexBasic> generateVertices()
-	{
-		std::vector<VertexBasic> vertices;
-		for (int i = 0; i < indices.size(); i++)
-		{
-			vertices.push_back(points[indices[i]]);
-		}
-		return vertices;
-	}
-
 	bool detectCollision(Anivia &anivia)
 	{
 		float distance;
@@ -0,0 +1,126 @@
+#ifndef MODELVERTEX_H
+#define MODELVERTEX_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "vertexlayout.h"
+
+//Vertex structs uploaded to the GPU, attribute locations match shader.vert
+struct VertexBasic {
+	glm::vec3 pos;
+	glm::vec3 normal;
+	glm::vec2 texCoor;
+};
+struct terrainVertex :VertexBasic
+{
+	glm::vec3 shadow;
+};
+struct EnemyVertex :VertexBasic {
+	glm::vec3 pos_idle;
+	glm::vec3 normal_idle;
+	glm::vec3 pos_dead;
+	glm::vec3 normal_dead;
+};
+struct AniviaVertex :VertexBasic
+{
+	glm::vec3 pos_idle;
+	glm::vec3 normal_idle;
+	glm::vec3 pos_attack;
+	glm::vec3 normal_attack;
+	glm::vec3 pos_dead;
+	glm::vec3 normal_dead;
+};
+
+struct BossVertex :VertexBasic {
+	glm::vec3 pos_idle;
+	glm::vec3 normal_idle;
+	glm::vec3 pos_attack;
+	glm::vec3 normal_attack;
+};
+
+#define VERTEX_ATTRIBUTE(type, member, location, components, semantic) \
+	{ location, components, unsigned(offsetof(type, member)), semantic }
+
+template <> inline VertexLayout vertexLayout<VertexBasic>()
+{
+	VertexLayout layout;
+	layout.stride = sizeof(VertexBasic);
+	VertexAttribute attributes[] = {
+		VERTEX_ATTRIBUTE(VertexBasic, pos, 0, 3, SEMANTIC_POSITION),
+		VERTEX_ATTRIBUTE(VertexBasic, normal, 1, 3, SEMANTIC_NORMAL),
+		VERTEX_ATTRIBUTE(VertexBasic, texCoor, 8, 2, SEMANTIC_TEXCOORD)
+	};
+	layout.attributes.assign(attributes, attributes + 3);
+	return layout;
+}
+
+template <> inline VertexLayout vertexLayout<EnemyVertex>()
+{
+	VertexLayout layout;
+	layout.stride = sizeof(EnemyVertex);
+	VertexAttribute attributes[] = {
+		VERTEX_ATTRIBUTE(EnemyVertex, pos, 0, 3, SEMANTIC_POSITION),
+		VERTEX_ATTRIBUTE(EnemyVertex, normal, 1, 3, SEMANTIC_NORMAL),
+		VERTEX_ATTRIBUTE(EnemyVertex, pos_idle, 2, 3, SEMANTIC_POSITION),
+		VERTEX_ATTRIBUTE(EnemyVertex, normal_idle, 3, 3, SEMANTIC_NORMAL),
+		VERTEX_ATTRIBUTE(EnemyVertex, pos_dead, 6, 3, SEMANTIC_POSITION),
+		VERTEX_ATTRIBUTE(EnemyVertex, normal_dead, 7, 3, SEMANTIC_NORMAL),
+		VERTEX_ATTRIBUTE(EnemyVertex, texCoor, 8, 2, SEMANTIC_TEXCOORD)
+	};
+	layout.attributes.assign(attributes, attributes + 7);
+	return layout;
+}
+
+template <> inline VertexLayout vertexLayout<AniviaVertex>()
+{
+	VertexLayout layout;
+	layout.stride = sizeof(AniviaVertex);
+	VertexAttribute attributes[] = {
+		VERTEX_ATTRIBUTE(AniviaVertex, pos, 0, 3, SEMANTIC_POSITION),
+		VERTEX_ATTRIBUTE(AniviaVertex, normal, 1, 3, SEMANTIC_NORMAL),
+		VERTEX_ATTRIBUTE(AniviaVertex, pos_idle, 2, 3, SEMANTIC_POSITION),
+		VERTEX_ATTRIBUTE(AniviaVertex, normal_idle, 3, 3, SEMANTIC_NORMAL),
+		VERTEX_ATTRIBUTE(AniviaVertex, pos_attack, 4, 3, SEMANTIC_POSITION),
+		VERTEX_ATTRIBUTE(AniviaVertex, normal_attack, 5, 3, SEMANTIC_NORMAL),
+		VERTEX_ATTRIBUTE(AniviaVertex, pos_dead, 6, 3, SEMANTIC_POSITION),
+		VERTEX_ATTRIBUTE(AniviaVertex, normal_dead, 7, 3, SEMANTIC_NORMAL),
+		VERTEX_ATTRIBUTE(AniviaVertex, texCoor, 8, 2, SEMANTIC_TEXCOORD)
+	};
+	layout.attributes.assign(attributes, attributes + 9);
+	return layout;
+}
+
+template <> inline VertexLayout vertexLayout<BossVertex>()
+{
+	VertexLayout layout;
+	layout.stride = sizeof(BossVertex);
+	VertexAttribute attributes[] = {
+		VERTEX_ATTRIBUTE(BossVertex, pos, 0, 3, SEMANTIC_POSITION),
+		VERTEX_ATTRIBUTE(BossVertex, normal, 1, 3, SEMANTIC_NORMAL),
+		VERTEX_ATTRIBUTE(BossVertex, pos_idle, 2, 3, SEMANTIC_POSITION),
+		VERTEX_ATTRIBUTE(BossVertex, normal_idle, 3, 3, SEMANTIC_NORMAL),
+		VERTEX_ATTRIBUTE(BossVertex, pos_attack, 4, 3, SEMANTIC_POSITION),
+		VERTEX_ATTRIBUTE(BossVertex, normal_attack, 5, 3, SEMANTIC_NORMAL),
+		VERTEX_ATTRIBUTE(BossVertex, texCoor, 8, 2, SEMANTIC_TEXCOORD)
+	};
+	layout.attributes.assign(attributes, attributes + 7);
+	return layout;
+}
+
+template <> inline VertexLayout vertexLayout<terrainVertex>()
+{
+	VertexLayout layout;
+	layout.stride = sizeof(terrainVertex);
+	VertexAttribute attributes[] = {
+		VERTEX_ATTRIBUTE(terrainVertex, pos, 0, 3, SEMANTIC_POSITION),
+		VERTEX_ATTRIBUTE(terrainVertex, normal, 1, 3, SEMANTIC_NORMAL),
+		VERTEX_ATTRIBUTE(terrainVertex, texCoor, 8, 2, SEMANTIC_TEXCOORD),
+		VERTEX_ATTRIBUTE(terrainVertex, shadow, 9, 3, SEMANTIC_COLOR)
+	};
+	layout.attributes.assign(attributes, attributes + 4);
+	return layout;
+}
+
+#undef VERTEX_ATTRIBUTE
+
+#endif // MODELVERTEX_H
@@ -12,7 +12,6 @@ public:
     inline Vertex (const Vec3Df & p) : p (p) {}
     inline Vertex (const Vec3Df & p, const Vec3Df & n) : p (p), n (n) {}
     inline Vertex (const Vertex & v) : p (v.p), n (v.n) {}
-    inline virtual ~Vertex () {}
     inline Vertex & operator= (const Vertex & v) {
         p = v.p;
         n = v.n;
@@ -0,0 +1,58 @@
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/************************************************************
+ * Asset loader
+ * Runs the CPU side of asset loading (OBJ parsing, texture
+ * decoding, LOD building) on a pool of loader threads. Only the
+ * main thread owns the GL context, so every job can hand an
+ * upload step back to it: finish() runs these uploads as soon
+ * as their job is done, while the other jobs keep running.
+ ************************************************************/
+
+class AssetLoader
+{
+public:
+	//0 threads means one per hardware thread
+	explicit AssetLoader(unsigned int threads = 0);
+	~AssetLoader();
+
+	//Queue 'work' for a loader thread. If it returns true, 'upload' (if any) is run on the
+	//main thread by finish(). Can be called from inside a work function, e.g. to split a job.
+	void add(std::function<bool()> work, std::function<void()> upload = std::function<void()>());
+
+	//Main thread only: run the uploads until all jobs (including the ones added meanwhile) are done.
+	//Returns false if any work function failed.
+	bool finish();
+
+private:
+	struct Job
+	{
+		std::function<bool()> work;
+		std::function<void()> upload;
+	};
+
+	void workerLoop();
+
+	AssetLoader(const AssetLoader &);
+	AssetLoader & operator=(const AssetLoader &);
+
+	std::vector<std::thread> mWorkers;
+	std::mutex mMutex;
+	std::condition_variable mJobReady;
+	std::condition_variable mUploadReady;
+	std::deque<Job> mJobs;
+	std::deque<std::function<void()> > mUploads;
+	size_t mPending;    //jobs added but not completely finished (work and upload)
+	bool mFailed;
+	bool mStop;
+};
+
+#endif // ASSETLOADER_H
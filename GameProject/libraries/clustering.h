@@ -0,0 +1,86 @@
+#ifndef CLUSTERING_H
+#define CLUSTERING_H
+
+#include "mesh.h"
+#include "gridcell.h"
+#include <vector>
+#include <stdint.h>
+
+/************************************************************
+ * Vertex clustering
+ * Engine behind Grid::simplifyMesh: every vertex gets the key of
+ * its grid cell, the (key, vertex) pairs are radix sorted, and each
+ * run of equal keys is reduced to one representative with running
+ * sums. No per-cell containers, no map lookups, and only the cells
+ * that hold vertices are ever touched. Binning, reduction and the
+ * triangle remapping run multi-threaded for large meshes.
+ ************************************************************/
+
+//Stable LSD radix sort of the keys, the values move along. Only as many 11 bit passes as
+//'maxKey' needs (two for r = 70).
+void radixSortPairs(std::vector<CellKey> & keys, std::vector<uint32_t> & values, CellKey maxKey);
+
+struct VertexClusters
+{
+	unsigned int r;                       //grid resolution
+	std::vector<uint32_t> vertexCluster;  //cluster of every input vertex
+	std::vector<CellKey> cellKeys;        //Morton key of the cell of every cluster, ascending
+	std::vector<Vertex> representatives;  //mean position of every cluster, zero normal
+	std::vector<Vec3Df> sums;             //position sum of every cluster
+	std::vector<uint32_t> counts;         //vertices in every cluster
+	int parent;                           //clusterVertexLevels: level this one was reduced from, -1 if none
+	std::vector<uint32_t> parentToCluster; //cluster of every cluster of the parent level
+};
+
+//Cluster the vertices on the r x r x r grid with its min corner at 'origin' and extent 'size'.
+//Gives the same cells, in the same order, and the same representatives (bit for bit) as
+//Grid::putVertices and Grid::computeRepresentatives. Large meshes are binned on 'threads'
+//threads (0: all cores) and the key space is split into one partition per thread, each sorted
+//and reduced on its own; the result does not depend on the thread count. 'r' is clamped to
+//[1, MAX_GRID_RESOLUTION].
+void clusterVertices(const std::vector<Vertex> & vertices, const Vec3Df & origin, float size, unsigned int r,
+	VertexClusters & clusters, unsigned int threads = 0);
+
+//Clusters for several resolutions with a single binning pass over the vertices: the finest
+//resolution is clustered as clusterVertices does, every coarser one is reduced from the cell
+//sums of a finer level. Each finer cell goes to the coarser cell that contains its center, which
+//is exact when the finer r is a multiple of the coarser r (that level is used when there is
+//one, the finest level otherwise). levels[i] belongs to resolutions[i].
+void clusterVertexLevels(const std::vector<Vertex> & vertices, const Vec3Df & origin, float size,
+	const std::vector<unsigned int> & resolutions, std::vector<VertexClusters> & levels);
+
+//The triangles between the clusters. Triangles with all corners in one cluster are dropped.
+//Runs as a parallel count of the survivors followed by a parallel compaction, so the triangles
+//keep their order.
+void clusterTriangles(const std::vector<Triangle> & triangles, const VertexClusters & clusters,
+	std::vector<Triangle> & clustered, unsigned int threads = 0);
+
+//Same for any vertex map. Remapping the triangles of a parent level with parentToCluster gives
+//the same triangles as clusterTriangles on the source mesh, from a much shorter list.
+void remapTriangles(const std::vector<Triangle> & triangles, const std::vector<uint32_t> & map,
+	std::vector<Triangle> & remapped, unsigned int threads = 0);
+
+//Writes a simplified level straight into a GPU vertex type with 'pos' and 'normal' members
+//(e.g. BossVertex) plus indices; the other members are value initialized.
+template <typename T>
+void levelVertices(const MeshSoA & level, std::vector<T> & vertices, std::vector<uint32_t> & indices)
+{
+	vertices.assign(level.vertexCount(), T());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		vertices[i].pos.x = level.px[i];
+		vertices[i].pos.y = level.py[i];
+		vertices[i].pos.z = level.pz[i];
+		vertices[i].normal.x = level.nx[i];
+		vertices[i].normal.y = level.ny[i];
+		vertices[i].normal.z = level.nz[i];
+	}
+	indices.resize(3 * level.triangles.size());
+	for (size_t i = 0; i < level.triangles.size(); i++)
+	{
+		for (int j = 0; j < 3; j++)
+			indices[3 * i + j] = level.triangles[i].v[j];
+	}
+}
+
+#endif // CLUSTERING_H
@@ -5,10 +5,12 @@
 #include <vector>
 #include "Vertex.h"
 #include "mesh.h"
+#include "gridcell.h"
 #include <map>
 
-typedef std::map<unsigned, std::vector<Vec3Df> > CellContent;
-typedef std::map<unsigned, Vertex> RepresentativeList;
+//keyed by the Morton key of the cell (see gridcell.h)
+typedef std::map<CellKey, std::vector<Vec3Df> > CellContent;
+typedef std::map<CellKey, Vertex> RepresentativeList;
 
 //The above structures can be used almost like a vector!
 //The difference is that they are sparse. This means: each entry will only exist ONCE in memory and only after it has been used. 
@@ -38,9 +40,26 @@ public:
 	//draw all the cells
     void drawGrid();
 
-	Mesh simplifyMesh(Mesh mesh, unsigned int r);
+	//'threads' 0 means all cores; the result is the same for any count
+	Mesh simplifyMesh(const Mesh & mesh, unsigned int r, unsigned int threads = 0);
+	//simplifyMesh without the final centering and scaling: the clusters stay in the frame of
+	//'mesh', so the result can be compared with it (see meshdistance.h); normals are not computed
+	Mesh clusterMesh(const Mesh & mesh, unsigned int r, unsigned int threads = 0);
+	//All the resolutions at once, from a single binning pass over the vertices (see
+	//clusterVertexLevels): the finest level is simplifyMesh, the coarser ones are reduced from
+	//finer cells. levels[i] belongs to resolutions[i], either as Mesh or as structure of arrays.
+	std::vector<Mesh> simplifyMeshLevels(const Mesh & mesh, const std::vector<unsigned int> & resolutions);
+	void simplifyMeshLevels(const Mesh & mesh, const std::vector<unsigned int> & resolutions, std::vector<MeshSoA> & levels);
+	//Out of core simplifyMesh for an OBJ or mesh cache file that does not fit in memory: the file
+	//is streamed three times (bounds, cell sums, triangles) in pieces of 'chunkSize' bytes and
+	//only the occupied cells are kept; the cell of every vertex goes through a temporary file
+	//(tmpfile()). Same result as simplifyMesh on the file loaded without centering. False when
+	//the file cannot be read or r is not in [1, MAX_GRID_RESOLUTION].
+	bool simplifyMeshStreaming(const char * filename, unsigned int r, Mesh & simplified, size_t chunkSize = 64 << 20);
+	//map based original of simplifyMesh, kept as reference for tools/gridbench
+	Mesh simplifyMeshLegacy(const Mesh & mesh, unsigned int r);
 
-	//number of grid cells
+	//number of grid cells, at most MAX_GRID_RESOLUTION
     unsigned int r;
 	//position of the grid (min corner is at origin and its extent is defined by size).
     Vec3Df origin;
@@ -51,8 +70,8 @@ public:
 	void addToCell(const Vec3Df & vertexPos);
     //add all vertices of the model to the cells
 	void putVertices(const std::vector<Vertex> & vertices);
-    //find the index containing the given point, return -1 if it cannot be found
-	int isContainedAt(const Vec3Df & pos);
+    //key of the cell containing the given point; points outside the grid go to the nearest cell
+	CellKey isContainedAt(const Vec3Df & pos);
 
 	//for each cell, compute a representative point of all contained points
 	void computeRepresentatives();
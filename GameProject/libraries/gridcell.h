@@ -0,0 +1,79 @@
+#ifndef GRIDCELL_H
+#define GRIDCELL_H
+
+#include "Vec3D.h"
+#include <stdint.h>
+
+/************************************************************
+ * Grid cell keys
+ * A cell is addressed by its integer coordinates, clamped to the
+ * grid, interleaved bit by bit into a 64 bit Morton (Z-order) key:
+ * 21 bits per axis, so resolutions up to 2^21 fit. Cells that are
+ * close in space are close in key order, so sorted cell data keeps
+ * its neighbours together.
+ ************************************************************/
+
+typedef uint64_t CellKey;
+
+const unsigned int MAX_GRID_RESOLUTION = 1u << 21;
+
+//'r' brought into [1, MAX_GRID_RESOLUTION]: past that the keys of distant cells would collide
+inline unsigned int clampGridResolution(unsigned int r)
+{
+	return r < 1 ? 1 : r > MAX_GRID_RESOLUTION ? MAX_GRID_RESOLUTION : r;
+}
+
+//spreads the low 21 bits of v to every third bit
+inline uint64_t mortonSpread(uint64_t v)
+{
+	v &= 0x1fffff;
+	v = (v | v << 32) & 0x1f00000000ffffull;
+	v = (v | v << 16) & 0x1f0000ff0000ffull;
+	v = (v | v << 8) & 0x100f00f00f00f00full;
+	v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+	v = (v | v << 2) & 0x1249249249249249ull;
+	return v;
+}
+
+//inverse of mortonSpread
+inline uint32_t mortonCompact(uint64_t v)
+{
+	v &= 0x1249249249249249ull;
+	v = (v ^ (v >> 2)) & 0x10c30c30c30c30c3ull;
+	v = (v ^ (v >> 4)) & 0x100f00f00f00f00full;
+	v = (v ^ (v >> 8)) & 0x1f0000ff0000ffull;
+	v = (v ^ (v >> 16)) & 0x1f00000000ffffull;
+	v = (v ^ (v >> 32)) & 0x1fffff;
+	return uint32_t(v);
+}
+
+inline CellKey mortonKey(uint32_t x, uint32_t y, uint32_t z)
+{
+	return mortonSpread(x) | mortonSpread(y) << 1 | mortonSpread(z) << 2;
+}
+
+inline void mortonCoordinates(CellKey key, uint32_t & x, uint32_t & y, uint32_t & z)
+{
+	x = mortonCompact(key);
+	y = mortonCompact(key >> 1);
+	z = mortonCompact(key >> 2);
+}
+
+//cell coordinate of a grid relative position, clamped to [0, r - 1] (NaN goes to 0)
+inline uint32_t gridCellCoordinate(float v, float cubeLength, unsigned int r)
+{
+	float c = v / cubeLength;
+	if (!(c >= 0.0f))
+		return 0;
+	return c >= float(r) ? r - 1 : uint32_t(c);
+}
+
+//key of the cell of 'p' in the r x r x r grid with its min corner at 'origin'
+inline CellKey gridCellKey(const Vec3Df & p, const Vec3Df & origin, float cubeLength, unsigned int r)
+{
+	Vec3Df v = p - origin;
+	return mortonKey(gridCellCoordinate(v[0], cubeLength, r), gridCellCoordinate(v[1], cubeLength, r),
+		gridCellCoordinate(v[2], cubeLength, r));
+}
+
+#endif // GRIDCELL_H
@@ -0,0 +1,59 @@
+#ifndef LODASSET_H
+#define LODASSET_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include "ModelVertex.h"
+#include "lodchain.h"
+#include "meshoptimize.h"
+
+/************************************************************
+ * Simplified level assets
+ * A mesh loaded with Mesh::loadMesh followed by its grid
+ * simplifications (Grid::simplifyMeshLevels) at a declared set
+ * of resolutions (or the resolutions that meet declared error
+ * bounds) or its quadric edge collapses at declared triangle
+ * ratios, in one vertex and one index array with a
+ * LodLevel range per level. tools/lodbake cooks them into mesh
+ * caches keyed by the source hash and the parameters below, the
+ * game only simplifies at startup when a cache is stale.
+ ************************************************************/
+
+//what builds the simplified levels of a LodAsset
+enum SimplifyEngine
+{
+	SIMPLIFY_GRID,   //Grid vertex clustering at 'resolutions' (or 'maxErrors')
+	SIMPLIFY_QUADRIC //QuadricSimplifier edge collapses down to 'triangleRatios'
+};
+
+struct LodAsset
+{
+	const char * name;
+	const char * cacheFile;
+	const char * sourceFile;
+	SimplifyEngine engine;
+	std::vector<unsigned int> resolutions; //simplified levels after the source mesh, fine to coarse
+	std::vector<float> maxErrors;          //if set, replaces 'resolutions': the coarsest resolution whose
+	                                       //Hausdorff distance stays within each error (resolutionForError)
+	std::vector<float> triangleRatios;     //SIMPLIFY_QUADRIC: triangles of each level over those of the source
+	glm::vec3 levelOffset;                 //moves the simplified levels (not the source mesh) in model space
+
+	//hash of the bake parameters, part of the cache key
+	uint64_t parameters() const;
+};
+
+//the damage states of the boss, shells drawn over the textured boss
+LodAsset bossDamageAsset();
+
+//level 0 is the source mesh, then one level per resolution, each optimized for the vertex cache
+//('report' receives the statistics of the source mesh); only pos and normal are set
+bool bakeLodAsset(const LodAsset & asset, std::vector<BossVertex> & vertices, std::vector<uint32_t> & indices,
+	std::vector<LodLevel> & levels, std::string & error, MeshOptimizeReport * report = 0);
+
+//load the levels from the mesh cache of the asset, baking (and caching) them when the cache is stale
+bool loadLodAsset(const LodAsset & asset, std::vector<BossVertex> & vertices, std::vector<uint32_t> & indices,
+	std::vector<LodLevel> & levels);
+
+#endif // LODASSET_H
@@ -0,0 +1,109 @@
+#ifndef LODCHAIN_H
+#define LODCHAIN_H
+
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+#include "vertexlayout.h"
+#include "meshoptimize.h"
+
+/************************************************************
+ * Level of detail chains
+ * Simplified copies of a mesh made by the grid clustering of
+ * clustering.h, appended to the vertex and index arrays of the
+ * mesh itself, so one vertex and one index buffer hold every
+ * level and switching levels only changes the draw range.
+ * Vertices of any interleaved float layout are clustered on
+ * their first position attribute; every attribute of a cluster
+ * (all morph poses, normals, texture coordinates) is the mean
+ * of its vertices, with normals renormalized.
+ * At runtime a level is picked from the projected size of the
+ * bounding sphere: the coarsest level whose cells stay below
+ * LOD_PIXEL_ERROR pixels on screen, with hysteresis.
+ ************************************************************/
+
+struct LodLevel
+{
+	uint32_t firstIndex; //first index of the level in the index array
+	uint32_t indexCount;
+	float error;         //size of a clustering cell in model units, 0 for the full mesh
+};
+
+struct LodChain
+{
+	std::vector<LodLevel> levels; //levels[0] is the full mesh, then coarser and coarser
+	float radius = 0.0f;          //bounding sphere around the model origin, over all poses
+
+	inline size_t triangles(int level) const { return levels[level].indexCount / 3; }
+};
+
+//triangles drawn against triangles the full meshes would have needed
+struct LodStats
+{
+	size_t fullTriangles = 0;
+	size_t drawnTriangles = 0;
+};
+
+const float LOD_PIXEL_ERROR = 2.0f;  //largest cell size on screen a level may show, in pixels
+const float LOD_HYSTERESIS = 0.25f;  //levels switch at LOD_PIXEL_ERROR * (1 -+ LOD_HYSTERESIS)
+const uint32_t LOD_CLUSTERING_VERSION = 2; //part of the bake parameters, so baked levels are rebuilt when it changes
+
+//Level to draw for a bounding sphere that is 'projectedRadius' pixels big on screen, given the
+//level drawn so far: coarser levels are only taken once their error is clearly below the
+//limit, finer ones once the current level is clearly above it, so levels do not flicker.
+int selectLodLevel(const LodChain & chain, float projectedRadius, int current,
+	float maxPixelError = LOD_PIXEL_ERROR, float hysteresis = LOD_HYSTERESIS);
+
+//Clusters 'vertexCount' interleaved vertices of 'layout' at every resolution (see
+//clusterVertexLevels) and returns each level as vertices of the same layout plus indices into
+//them; triangles that collapse to a line or a point are dropped. errors[i] is the cell size.
+//Every attribute is averaged over the cell (positions and normals of all morph targets too),
+//except texture coordinates: a cell crossed by a UV seam gets one vertex per side of the seam,
+//with the shared geometry of the cell and the texture coordinates of its own side.
+void clusterInterleavedLevels(const float * vertices, size_t vertexCount, const VertexLayout & layout,
+	const uint32_t * indices, size_t indexCount, const std::vector<unsigned int> & resolutions,
+	std::vector<std::vector<float> > & levelVertices, std::vector<std::vector<uint32_t> > & levelIndices,
+	std::vector<float> & errors);
+
+//largest distance of any position attribute from the origin
+float lodBoundingRadius(const float * vertices, size_t vertexCount, const VertexLayout & layout);
+
+//Appends the simplified levels of vertices/indices to them (each optimized with optimizeMesh)
+//and describes the ranges in 'chain'. Levels without fewer triangles than the previous one are
+//skipped. 'resolutions' go from fine to coarse.
+template <typename T>
+void buildLodChain(std::vector<T> & vertices, std::vector<uint32_t> & indices, const std::vector<unsigned int> & resolutions,
+	LodChain & chain)
+{
+	static_assert(sizeof(T) % sizeof(float) == 0, "vertex structs are made of floats");
+	const float * floats = vertices.empty() ? 0 : reinterpret_cast<const float *>(&vertices[0]);
+	VertexLayout layout = vertexLayout<T>();
+	chain.radius = lodBoundingRadius(floats, vertices.size(), layout);
+	chain.levels.clear();
+	LodLevel full = { 0, uint32_t(indices.size()), 0.0f };
+	chain.levels.push_back(full);
+
+	std::vector<std::vector<float> > levelVertices;
+	std::vector<std::vector<uint32_t> > levelIndices;
+	std::vector<float> errors;
+	clusterInterleavedLevels(floats, vertices.size(), layout, indices.empty() ? 0 : &indices[0], indices.size(),
+		resolutions, levelVertices, levelIndices, errors);
+
+	for (size_t l = 0; l < resolutions.size(); l++)
+	{
+		if (levelIndices[l].empty() || levelIndices[l].size() >= chain.levels.back().indexCount)
+			continue;
+		std::vector<T> level(levelVertices[l].size() * sizeof(float) / sizeof(T));
+		memcpy(static_cast<void*>(&level[0]), &levelVertices[l][0], level.size() * sizeof(T));
+		optimizeMesh(level, levelIndices[l]);
+
+		uint32_t base = uint32_t(vertices.size());
+		LodLevel range = { uint32_t(indices.size()), uint32_t(levelIndices[l].size()), errors[l] };
+		vertices.insert(vertices.end(), level.begin(), level.end());
+		for (size_t i = 0; i < levelIndices[l].size(); i++)
+			indices.push_back(base + levelIndices[l][i]);
+		chain.levels.push_back(range);
+	}
+}
+
+#endif // LODCHAIN_H
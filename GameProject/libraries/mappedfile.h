@@ -0,0 +1,48 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdio>
+
+/************************************************************
+ * Read-only memory mapped file
+ * The whole file is mapped at once, data() stays valid until
+ * close() is called or the object is destroyed.
+ ************************************************************/
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const char * filename);
+    //maps what has been written to a file opened for update, e.g. by tmpfile(); the file can be
+    //closed afterwards, the mapping keeps it alive
+    bool open(FILE * file);
+    void close();
+
+    inline const char * data() const { return mData; }
+    inline size_t size() const { return mSize; }
+    inline bool isOpen() const { return mData != 0 || mOpenEmpty; }
+
+private:
+    //not copyable, the mapping is owned by exactly one object
+    MappedFile(const MappedFile &);
+    MappedFile & operator= (const MappedFile &);
+
+    //maps the whole file and takes ownership of the handle / descriptor
+#ifdef WIN32
+    bool mapHandle(void * file);
+#else
+    bool mapDescriptor(int fd);
+#endif
+
+    const char * mData;
+    size_t mSize;
+    bool mOpenEmpty;
+#ifdef WIN32
+    void * mFile;
+    void * mMapping;
+#endif
+};
+
+#endif // MAPPEDFILE_H
@@ -2,6 +2,7 @@
 #define MESH_H
 
 #include "Vertex.h"
+#include "meshsoa.h"
 #include <vector>
 
 /************************************************************
@@ -22,7 +23,6 @@ public:
         v[1] = v1;
         v[2] = v2;
     }
-    inline virtual ~Triangle () {}
     inline Triangle & operator= (const Triangle & t) {
         v[0] = t.v[0];
         v[1] = t.v[1];
@@ -42,10 +42,15 @@ public:
     std::vector<Vertex> vertices;
     std::vector<Triangle> triangles;
 
+    //memory mapped, multi-threaded OBJ loader (see objparser.h)
     bool loadMesh(const char * filename);
-    void computeVertexNormals ();
+    //original fgets/sscanf loader, kept as reference for tools/objbench
+    bool loadMeshLegacy(const char * filename);
+    void computeVertexNormals (NormalWeighting weighting = NORMAL_WEIGHT_UNIFORM);
     void centerAndScaleToUnit ();
     void computeBoundingCube();
+    //centerAndScaleToUnit, computeVertexNormals and computeBoundingCube in one go
+    void centerNormalsAndBounds ();
 
     //Bounding box information
 	//point of bounding box with minimal coordinates ("lower left corner")
@@ -0,0 +1,121 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+#include "mappedfile.h"
+#include "vertexlayout.h"
+#include "lodchain.h"
+
+/************************************************************
+ * Binary mesh cache
+ * A cache file holds vertex data ready for glBufferData:
+ *   header | vertex layout | vertex blob | index blob | levels
+ * The optional level table gives the index range of every level
+ * of detail stored in the blobs (see lodchain.h).
+ * The header stores a hash of the source files the data was
+ * built from, mixed with the parameters it was built with. A
+ * cache whose version, hash or vertex layout does not match is
+ * considered stale.
+ ************************************************************/
+
+const uint32_t MESH_CACHE_VERSION = 4;
+
+struct MeshCacheHeader
+{
+	char magic[4];          //"FFMC"
+	uint32_t version;       //MESH_CACHE_VERSION
+	uint64_t sourceHash;    //hashFiles() of the source files, mixed with the build parameters (hashParameters)
+	uint32_t stride;        //bytes per vertex
+	uint32_t attributeCount;
+	uint64_t vertexCount;
+	uint64_t indexCount;    //0 for non indexed geometry
+	uint32_t indexSize;     //bytes per index (2 or 4), 0 without indices
+	uint32_t levelCount;    //LodLevel entries of the level table, 0 without one
+	uint64_t vertexOffset;  //byte offset of the vertex blob in the file
+	uint64_t indexOffset;   //byte offset of the index blob in the file
+	uint64_t levelOffset;   //byte offset of the level table in the file
+};
+
+//64 bit FNV-1a hash of the contents of all files, in the given order
+bool hashFiles(const std::vector<std::string> & filenames, uint64_t & hash);
+
+//continue 'hash' with the bytes of the parameters cached data is built with (resolutions, offsets, ...)
+uint64_t hashParameters(uint64_t hash, const void * data, size_t size);
+
+//write a cache file (through a temporary file, so a crash never leaves a half written cache)
+bool writeMeshCache(const char * filename, uint64_t sourceHash, const VertexLayout & layout,
+	const void * vertices, size_t vertexCount, const uint32_t * indices = 0, size_t indexCount = 0,
+	const LodLevel * levels = 0, size_t levelCount = 0);
+
+//read-only view on a cache file, the file is mapped once and the blobs point into the mapping
+class MeshCache
+{
+public:
+	//fails if the file is missing, damaged or stale; damaged includes blobs past the end of the
+	//file and indices past the vertices, so the blobs can go to the GPU without further checks
+	bool open(const char * filename, uint64_t sourceHash, const VertexLayout & layout, bool checkHash = true);
+	//any vertex layout and source hash, for tools that read caches generically (see layout())
+	bool open(const char * filename);
+	void close();
+
+	inline const void * vertexData() const { return mFile.data() + mHeader.vertexOffset; }
+	inline size_t vertexCount() const { return size_t(mHeader.vertexCount); }
+	inline const void * indexData() const { return mFile.data() + mHeader.indexOffset; }
+	inline size_t indexCount() const { return size_t(mHeader.indexCount); }
+	inline unsigned int indexSize() const { return mHeader.indexSize; }
+	inline const LodLevel * levelData() const { return reinterpret_cast<const LodLevel *>(mFile.data() + mHeader.levelOffset); }
+	inline size_t levelCount() const { return mHeader.levelCount; }
+	inline const VertexLayout & layout() const { return mLayout; }
+
+private:
+	MappedFile mFile;
+	MeshCacheHeader mHeader;
+	VertexLayout mLayout;
+};
+
+//Fill 'vertices', 'indices' and 'levels' from the cache file, or call build(vertices, indices, levels) and write the
+//cache when it is stale. 'parameters' is a hash (hashParameters) of the settings build() uses, so changing them
+//makes the cache stale as well. If the sources cannot be read at all (e.g. only the cache is shipped), a cache with
+//the right layout is used as is.
+template <typename T, typename Builder>
+bool loadCachedMesh(const char * cacheFile, const std::vector<std::string> & sources, uint64_t parameters,
+	std::vector<T> & vertices, std::vector<uint32_t> & indices, std::vector<LodLevel> & levels, Builder build)
+{
+	uint64_t hash = 0;
+	bool haveSources = hashFiles(sources, hash);
+	hash = hashParameters(hash, &parameters, sizeof(parameters));
+
+	MeshCache cache;
+	if (cache.open(cacheFile, hash, vertexLayout<T>(), haveSources))
+	{
+		vertices.resize(cache.vertexCount());
+		if (!vertices.empty())
+			memcpy(&vertices[0], cache.vertexData(), vertices.size() * sizeof(T));
+		indices.resize(cache.indexCount());
+		if (cache.indexSize() == 2)
+		{
+			const uint16_t * narrow = reinterpret_cast<const uint16_t *>(cache.indexData());
+			indices.assign(narrow, narrow + cache.indexCount());
+		}
+		else if (!indices.empty())
+			memcpy(&indices[0], cache.indexData(), indices.size() * sizeof(uint32_t));
+		levels.assign(cache.levelData(), cache.levelData() + cache.levelCount());
+		return true;
+	}
+	if (!haveSources)
+		return false;
+
+	vertices.clear();
+	indices.clear();
+	levels.clear();
+	if (!build(vertices, indices, levels))
+		return false;
+	writeMeshCache(cacheFile, hash, vertexLayout<T>(), vertices.empty() ? 0 : &vertices[0], vertices.size(),
+		indices.empty() ? 0 : &indices[0], indices.size(), levels.empty() ? 0 : &levels[0], levels.size());
+	return true;
+}
+
+#endif // MESHCACHE_H
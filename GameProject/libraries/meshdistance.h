@@ -0,0 +1,75 @@
+#ifndef MESHDISTANCE_H
+#define MESHDISTANCE_H
+
+#include <vector>
+#include <stdint.h>
+#include "Vec3D.h"
+#include "Vertex.h"
+#include "mesh.h"
+
+/************************************************************
+ * Geometric error of simplified meshes
+ * Distances from sample points of one mesh (its vertices and
+ * triangle centroids) to the surface of the other. The closest
+ * triangle is found in a bounding volume hierarchy built with
+ * the binned surface area heuristic, the samples are split over
+ * threads. Two-sided Hausdorff and RMS distance are the maximum
+ * and the root mean square over both directions.
+ ************************************************************/
+
+class TriangleBvh
+{
+public:
+	void build(const std::vector<Vertex> & vertices, const std::vector<Triangle> & triangles);
+
+	//squared distance from 'p' to the closest triangle, 'hint' is a triangle to start from (e.g. the
+	//one found for the previous sample) and receives the closest one; FLT_MAX without triangles
+	float closestDistance2(const Vec3Df & p, uint32_t & hint) const;
+
+	inline bool empty() const { return mNodes.empty(); }
+
+private:
+	struct Node
+	{
+		float min[3];
+		float max[3];
+		uint32_t first; //first triangle of a leaf, left child of an inner node (the right one follows it)
+		uint32_t count; //triangles of a leaf, 0 for inner nodes
+	};
+
+	float triangleDistance2(const Vec3Df & p, uint32_t triangle) const;
+
+	std::vector<Node> mNodes;
+	std::vector<Vec3Df> mCorners; //three corners per triangle, in leaf order
+};
+
+//one direction: from the samples of a mesh to the surface of the other
+struct SurfaceDistance
+{
+	double max;
+	double rms;
+	size_t samples;
+};
+
+struct MeshError
+{
+	SurfaceDistance forward;  //reference samples to the simplified surface
+	SurfaceDistance backward; //simplified samples to the reference surface
+	double hausdorff;         //two-sided
+	double rms;               //over the samples of both directions
+};
+
+SurfaceDistance surfaceDistance(const Mesh & from, const TriangleBvh & to, unsigned int threads = 0);
+
+//both meshes have to be in the same frame (see Grid::clusterMesh); 'referenceBvh' may be passed
+//when the same reference is measured many times
+MeshError measureError(const Mesh & reference, const Mesh & simplified, unsigned int threads = 0,
+	const TriangleBvh * referenceBvh = 0);
+
+//Coarsest grid resolution (at most 'maxResolution') whose Grid::clusterMesh of 'mesh' keeps the
+//two-sided Hausdorff distance within 'maxError', in the units of the mesh. Found by bisection, as
+//the error only falls roughly monotonically with r.
+unsigned int resolutionForError(const Mesh & mesh, double maxError, unsigned int maxResolution = 512,
+	unsigned int threads = 0);
+
+#endif // MESHDISTANCE_H
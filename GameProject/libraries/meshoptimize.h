@@ -0,0 +1,90 @@
+#ifndef MESHOPTIMIZE_H
+#define MESHOPTIMIZE_H
+
+#include <vector>
+#include <cstring>
+#include <iosfwd>
+#include <stdint.h>
+#include "vertexlayout.h"
+
+class Mesh;
+
+/************************************************************
+ * Mesh optimization for indexed triangle lists
+ *  1. optimizeVertexCache: triangle order for the post-transform
+ *     vertex cache (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+ *  2. optimizeOverdraw: moves clusters of that order so outward
+ *     facing parts are drawn first (Sander et al., "Fast Triangle
+ *     Reordering for Vertex Locality and Reduced Overdraw"),
+ *     without losing more than 'threshold' in cache efficiency
+ *  3. optimizeVertexFetch: vertices in order of first use
+ * Cache efficiency is measured with a FIFO cache simulation.
+ ************************************************************/
+
+const unsigned int VERTEX_CACHE_SIZE = 16; //FIFO entries used for the statistics and the overdraw clusters
+
+struct VertexCacheStats
+{
+	size_t transformed; //vertex shader invocations
+	float acmr;         //average cache miss ratio: transformed vertices per triangle (0.5 is ideal for big meshes)
+	float atvr;         //average transformed vertex ratio: transformed vertices per vertex (1 is ideal)
+};
+
+struct MeshOptimizeReport
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+//one line summary: ACMR, ATVR and vertex shader invocations before -> after
+std::ostream & operator<<(std::ostream & stream, const MeshOptimizeReport & report);
+
+VertexCacheStats analyzeVertexCache(const uint32_t * indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+//'destination' receives the reordered indices and must not alias 'indices'
+void optimizeVertexCache(uint32_t * destination, const uint32_t * indices, size_t indexCount, size_t vertexCount);
+
+//'indices' must already be in vertex cache order; positions are 3 floats every 'positionStride' bytes
+void optimizeOverdraw(uint32_t * destination, const uint32_t * indices, size_t indexCount,
+	const float * positions, size_t vertexCount, size_t positionStride, float threshold = 1.05f);
+
+//remap[old vertex] = new vertex (0xffffffff for unused vertices) and rewrites the indices, returns the used vertex count
+size_t optimizeVertexFetchRemap(uint32_t * remap, uint32_t * indices, size_t indexCount, size_t vertexCount);
+
+//all three passes on raw data, 'positions' as for optimizeOverdraw; fills 'remap' as optimizeVertexFetchRemap
+size_t optimizeIndexedMesh(std::vector<uint32_t> & indices, std::vector<uint32_t> & remap,
+	const float * positions, size_t vertexCount, size_t positionStride, MeshOptimizeReport * report = 0);
+
+//optimize the triangle and vertex order of a Mesh (from mesh.cpp)
+void optimizeMesh(Mesh & mesh, MeshOptimizeReport * report = 0);
+
+//optimize an interleaved vertex array whose first SEMANTIC_POSITION attribute is the position
+template <typename T>
+void optimizeMesh(std::vector<T> & vertices, std::vector<uint32_t> & indices, MeshOptimizeReport * report = 0)
+{
+	VertexLayout layout = vertexLayout<T>();
+	size_t positionOffset = 0;
+	for (size_t i = 0; i < layout.attributes.size(); i++)
+	{
+		if (layout.attributes[i].semantic == SEMANTIC_POSITION)
+		{
+			positionOffset = layout.attributes[i].offset;
+			break;
+		}
+	}
+	const float * positions = vertices.empty() ? 0
+		: reinterpret_cast<const float *>(reinterpret_cast<const char *>(&vertices[0]) + positionOffset);
+
+	std::vector<uint32_t> remap;
+	size_t used = optimizeIndexedMesh(indices, remap, positions, vertices.size(), sizeof(T), report);
+
+	std::vector<T> reordered(used);
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		if (remap[i] != 0xffffffffu)
+			reordered[remap[i]] = vertices[i];
+	}
+	vertices.swap(reordered);
+}
+
+#endif // MESHOPTIMIZE_H
@@ -0,0 +1,107 @@
+#ifndef MESHSOA_H
+#define MESHSOA_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+class Mesh;
+
+/************************************************************
+ * Structure of arrays mesh
+ * Positions and normals as separate x/y/z float arrays and the
+ * triangles as plain index triples, so the per-vertex loops of
+ * Mesh (normals, centering, bounding cube) run as SSE/AVX kernels
+ * over contiguous floats. The kernels have a scalar fallback and
+ * give the same results as the Vec3Df code of Mesh: bounds and
+ * normals are bit identical, and the mean for the centering is
+ * summed in double in vertex order by both (the original summed
+ * it in float).
+ * Mesh keeps its own loops over its interleaved vertices
+ * (splitting them into arrays for the kernels and back costs
+ * more than the kernels save) and only uses the kernels for the
+ * weighted normals; fromMesh/toMesh convert whole meshes.
+ ************************************************************/
+
+enum SimdLevel
+{
+	SIMD_SCALAR,
+	SIMD_SSE,   //4 floats, SSE2
+	SIMD_AVX    //8 floats, needs -mavx or /arch:AVX at compile time
+};
+
+//highest level compiled in; levels above it fall back to it
+SimdLevel bestSimdLevel();
+const char * simdLevelName(SimdLevel level);
+
+struct TriangleIndices
+{
+	uint32_t v[3];
+};
+
+//how the normals of the triangles around a vertex are summed
+enum NormalWeighting
+{
+	NORMAL_WEIGHT_UNIFORM, //unit face normals, as Mesh always did
+	NORMAL_WEIGHT_AREA,    //face normals scaled by the triangle area
+	NORMAL_WEIGHT_ANGLE    //unit face normals scaled by the angle of the triangle at the vertex
+};
+
+//Vertex -> triangle adjacency in compressed sparse row form, built with a counting sort.
+//The corners of vertex v are corners[offsets[v]] .. corners[offsets[v + 1] - 1] in ascending
+//order; corner c is entry c of the index array, so it belongs to triangle c / 3.
+struct VertexTriangleAdjacency
+{
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> corners;
+
+	//'threads' 0 means all cores, the result is the same for any count
+	void build(const uint32_t * triangles, size_t triangleCount, size_t vertexCount, unsigned int threads = 0);
+};
+
+class MeshSoA
+{
+public:
+	MeshSoA();
+
+	std::vector<float> px, py, pz;
+	std::vector<float> nx, ny, nz;
+	std::vector<TriangleIndices> triangles;
+
+	//same meaning as in Mesh
+	float bbOrigin[3];
+	float bbEdgeSize;
+
+	size_t vertexCount() const { return px.size(); }
+	//resizes the position and normal arrays
+	void resize(size_t vertexCount);
+
+	void computeVertexNormals(NormalWeighting weighting = NORMAL_WEIGHT_UNIFORM, SimdLevel level = bestSimdLevel());
+	void centerAndScaleToUnit(SimdLevel level = bestSimdLevel());
+	void computeBoundingCube(SimdLevel level = bestSimdLevel());
+
+	//adapter for the array of structures Mesh
+	void fromMesh(const Mesh & mesh);
+	void toMesh(Mesh & mesh) const;
+};
+
+/************************************************************
+ * Kernels on raw arrays, used by MeshSoA and by Mesh directly.
+ * 'triangles' holds 3 indices per triangle.
+ ************************************************************/
+
+//Face normals in parallel, then every vertex gathers the normals of its triangles through the
+//adjacency, also in parallel ('threads' 0 means all cores; one thread or small meshes scatter
+//instead). Each vertex sums its triangles in index order, so the result does not depend on
+//the thread count, and uniform weights give the same bits as the old Mesh code.
+void soaComputeVertexNormals(const float * px, const float * py, const float * pz, size_t vertexCount,
+	const uint32_t * triangles, size_t triangleCount, float * nx, float * ny, float * nz,
+	NormalWeighting weighting = NORMAL_WEIGHT_UNIFORM, unsigned int threads = 0, SimdLevel level = bestSimdLevel());
+
+void soaCenterAndScaleToUnit(float * px, float * py, float * pz, size_t vertexCount, SimdLevel level = bestSimdLevel());
+
+//minimum and maximum of each coordinate (both 0 for an empty mesh)
+void soaBounds(const float * px, const float * py, const float * pz, size_t vertexCount,
+	float minPoint[3], float maxPoint[3], SimdLevel level = bestSimdLevel());
+
+#endif // MESHSOA_H
@@ -0,0 +1,42 @@
+#ifndef MESHSTREAM_H
+#define MESHSTREAM_H
+
+#include <string>
+#include <functional>
+#include <cstddef>
+#include <stdint.h>
+#include "meshcache.h"
+
+/************************************************************
+ * Streamed mesh source
+ * Positions and triangles of a mesh file, read front to back in
+ * pieces of bounded size, so files larger than memory can be
+ * processed. OBJ text is parsed piece by piece (streamObj); mesh
+ * cache files (meshcache.h) are mapped, which only costs address
+ * space, and walked in runs of vertices and indices. Every read
+ * goes through the whole file again.
+ ************************************************************/
+class MeshStream
+{
+public:
+	MeshStream();
+
+	//A mesh cache of any layout with a position attribute, otherwise an OBJ file.
+	//'chunkSize' is the size of a piece in bytes.
+	bool open(const char * filename, size_t chunkSize = 64 << 20);
+
+	//fn(xyz, count) for every piece: 3 floats per vertex, in file order
+	bool readPositions(const std::function<bool(const float *, size_t)> & fn);
+	//fn(indices, count) for every piece: 3 indices per triangle, in file order. Faces with more
+	//corners are fans around their first corner, as in Mesh::loadMesh. Indices are not checked.
+	bool readTriangles(const std::function<bool(const uint32_t *, size_t)> & fn);
+
+private:
+	std::string mFilename;
+	size_t mChunkSize;
+	bool mIsCache;
+	MeshCache mCache;
+	unsigned int mPositionOffset; //byte offset of the position in a cache vertex
+};
+
+#endif // MESHSTREAM_H
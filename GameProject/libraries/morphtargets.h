@@ -0,0 +1,137 @@
+#ifndef MORPHTARGETS_H
+#define MORPHTARGETS_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <glm/glm.hpp>
+#include "ModelVertex.h"
+#include "meshcache.h"
+#include "lodchain.h"
+#include "vertexweld.h"
+#include "meshoptimize.h"
+
+/************************************************************
+ * Morph target assets
+ * A character is built from a base OBJ (position, normal and
+ * texture coordinates) plus one OBJ per animation pose whose
+ * positions and normals go to extra members of the vertex
+ * struct (pos_idle, normal_idle, ...). All OBJs of a character
+ * must have the same topology, corners are matched by position.
+ ************************************************************/
+
+//one animation pose: where its position and normal go in the vertex struct
+struct MorphTarget
+{
+	const char * filename;
+	size_t posOffset;
+	size_t normalOffset;
+};
+
+struct MorphAsset
+{
+	const char * name;
+	const char * cacheFile;
+	const char * baseFile;
+	std::vector<MorphTarget> targets;
+	std::vector<unsigned int> lodResolutions; //levels of detail baked into the cache (see lodchain.h), none if empty
+
+	//all OBJ files the asset is built from (the base first)
+	std::vector<std::string> sources() const;
+	//hash of the bake parameters, part of the cache key
+	uint64_t parameters() const;
+};
+
+//the characters of the game, shared by the game and tools/morphbake
+MorphAsset aniviaAsset();   //AniviaVertex
+MorphAsset enemyAsset();    //EnemyVertex
+MorphAsset bossAsset();     //BossVertex
+MorphAsset iceBergAsset();  //VertexBasic, no morph targets
+
+//triangulated OBJ flattened to one entry per face corner, in file order
+struct MorphSource
+{
+	std::vector<glm::vec3> pos;
+	std::vector<glm::vec3> normal;
+	std::vector<glm::vec2> texCoor;
+	std::vector<int> vertexIndex;               //OBJ position index of every corner
+	std::vector<unsigned int> shapeCornerCount; //corners per OBJ shape
+};
+
+bool readMorphSource(const char * filename, MorphSource & source, std::string & error);
+//true when 'target' can be used as a morph target of 'base' (same shapes, faces and position indices)
+bool sameTopology(const MorphSource & base, const MorphSource & target, const char * targetName, std::string & error);
+
+//build the unique interleaved vertices and the triangle indices of an asset from its OBJ files,
+//optimized for the vertex cache, overdraw and vertex fetch ('report' receives the cache statistics
+//of the full mesh), followed by the levels of detail of asset.lodResolutions (ranges in 'levels')
+template <typename T>
+bool bakeMorphAsset(const MorphAsset & asset, std::vector<T> & vertices, std::vector<uint32_t> & indices,
+	std::vector<LodLevel> & levels, std::string & error, MeshOptimizeReport * report = 0)
+{
+	MorphSource base;
+	if (!readMorphSource(asset.baseFile, base, error))
+		return false;
+
+	vertices.assign(base.pos.size(), T());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		VertexBasic & vertex = vertices[i];
+		vertex.pos = base.pos[i];
+		vertex.normal = base.normal[i];
+		vertex.texCoor = base.texCoor[i];
+	}
+
+	for (size_t t = 0; t < asset.targets.size(); t++)
+	{
+		const MorphTarget & target = asset.targets[t];
+		MorphSource pose;
+		if (!readMorphSource(target.filename, pose, error) || !sameTopology(base, pose, target.filename, error))
+			return false;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			char * bytes = reinterpret_cast<char *>(&vertices[i]);
+			*reinterpret_cast<glm::vec3 *>(bytes + target.posOffset) = pose.pos[i];
+			*reinterpret_cast<glm::vec3 *>(bytes + target.normalOffset) = pose.normal[i];
+		}
+	}
+	//corners are only merged when they match in every pose
+	weldVertices(vertices, indices);
+	optimizeMesh(vertices, indices, report);
+	levels.clear();
+	if (!asset.lodResolutions.empty())
+	{
+		LodChain chain;
+		buildLodChain(vertices, indices, asset.lodResolutions, chain);
+		levels.swap(chain.levels);
+	}
+	return true;
+}
+
+//load an asset and its levels of detail from its mesh cache, baking (and caching) it from the OBJ files when the cache is stale
+template <typename T>
+bool loadMorphAsset(const MorphAsset & asset, std::vector<T> & vertices, std::vector<uint32_t> & indices, LodChain & lod)
+{
+	bool loaded = loadCachedMesh(asset.cacheFile, asset.sources(), asset.parameters(), vertices, indices, lod.levels,
+		[&asset](std::vector<T> & bakedVertices, std::vector<uint32_t> & bakedIndices, std::vector<LodLevel> & bakedLevels) {
+		std::string error;
+		if (!bakeMorphAsset(asset, bakedVertices, bakedIndices, bakedLevels, error))
+		{
+			std::cerr << error << std::endl;
+			return false;
+		}
+		return true;
+	});
+	lod.radius = vertices.empty() ? 0.0f
+		: lodBoundingRadius(reinterpret_cast<const float *>(&vertices[0]), vertices.size(), vertexLayout<T>());
+	return loaded;
+}
+
+template <typename T>
+bool loadMorphAsset(const MorphAsset & asset, std::vector<T> & vertices, std::vector<uint32_t> & indices)
+{
+	LodChain lod;
+	return loadMorphAsset(asset, vertices, indices, lod);
+}
+
+#endif // MORPHTARGETS_H
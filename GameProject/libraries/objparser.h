@@ -0,0 +1,52 @@
+#ifndef OBJPARSER_H
+#define OBJPARSER_H
+
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+/************************************************************
+ * Fast Wavefront OBJ parser
+ * The file is memory mapped, split into newline aligned chunks
+ * and every chunk is parsed on its own thread. Only geometry
+ * records are read (v, vt, vn, f), everything else is skipped.
+ ************************************************************/
+
+//one corner of a face, all indices are 0-based and -1 when absent
+struct ObjIndex {
+    int vertex;
+    int texcoord;
+    int normal;
+};
+
+struct ObjData {
+    std::vector<float> positions;        //x,y,z per "v" record
+    std::vector<float> texcoords;        //u,v per "vt" record
+    std::vector<float> normals;          //x,y,z per "vn" record
+    std::vector<ObjIndex> indices;       //corners of all faces in file order
+    std::vector<unsigned int> faceSizes; //number of corners of each face
+
+    void clear();
+    inline size_t vertexCount() const { return positions.size() / 3; }
+    inline size_t faceCount() const { return faceSizes.size(); }
+};
+
+//parse a whole file, threads == 0 uses all cores
+bool loadObj(const char * filename, ObjData & obj, unsigned int threads = 0);
+//parse an in-memory OBJ text (does not need to be zero terminated)
+void parseObj(const char * begin, const char * end, ObjData & obj, unsigned int threads = 0);
+
+//Parse a file of any size in newline aligned pieces of about 'chunkSize' bytes, only one piece
+//is in memory at a time. fn(piece) is called for every piece in file order; the face indices of
+//a piece are absolute for the whole file (0-based, relative OBJ indices resolved). Returns false
+//if the file cannot be read or fn returns false.
+bool streamObj(const char * filename, size_t chunkSize, const std::function<bool(const ObjData &)> & fn,
+    unsigned int threads = 0);
+
+//Number parsing used by the loader, exposed for other readers of text meshes.
+//Both return the position after the number, or p itself if no number could be read.
+//Floats are rounded exactly like strtof/sscanf("%f") would round them.
+const char * parseObjFloat(const char * p, const char * end, float & value);
+const char * parseObjInt(const char * p, const char * end, int & value);
+
+#endif // OBJPARSER_H
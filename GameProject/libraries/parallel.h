@@ -0,0 +1,50 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+//number of worker threads to use for data parallel loops (at least 1)
+inline unsigned int hardwareThreads() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+//Split [begin, end) into at most 'threads' contiguous ranges and call
+//fn(rangeBegin, rangeEnd, rangeIndex) for each of them on its own thread.
+//The calling thread runs the first range itself. Ranges are assigned in order,
+//so rangeIndex can be used to index per-thread results that are merged afterwards.
+//Returns the number of ranges that were used.
+template <typename Function>
+unsigned int parallelFor(size_t begin, size_t end, Function fn, unsigned int threads = 0, size_t minRangeSize = 1024) {
+    if (threads == 0)
+        threads = hardwareThreads();
+    size_t count = end > begin ? end - begin : 0;
+    if (minRangeSize == 0)
+        minRangeSize = 1;
+    size_t maxRanges = (count + minRangeSize - 1) / minRangeSize;
+    if (maxRanges < threads)
+        threads = (unsigned int)(maxRanges == 0 ? 1 : maxRanges);
+
+    if (threads <= 1) {
+        fn(begin, end, 0u);
+        return 1;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    size_t step = count / threads, rest = count % threads;
+    size_t first = begin + step + (rest > 0 ? 1 : 0);
+    for (unsigned int t = 1; t < threads; ++t) {
+        size_t last = first + step + (t < rest ? 1 : 0);
+        workers.push_back(std::thread(fn, first, last, t));
+        first = last;
+    }
+    fn(begin, begin + step + (rest > 0 ? 1 : 0), 0u);
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+    return threads;
+}
+
+#endif // PARALLEL_H
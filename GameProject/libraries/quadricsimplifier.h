@@ -0,0 +1,39 @@
+#ifndef QUADRICSIMPLIFIER_H
+#define QUADRICSIMPLIFIER_H
+
+#include "mesh.h"
+#include <vector>
+#include <stdint.h>
+
+/************************************************************
+ * Quadric error edge collapse
+ * Second simplification engine next to Grid: every vertex
+ * carries the quadric of the planes of its triangles (Garland
+ * and Heckbert), border edges add a plane perpendicular to the
+ * triangle so open borders stay in place. Edges are collapsed
+ * cheapest first to the position that minimizes the summed
+ * quadric, in rounds: the costs of all edges are computed on
+ * many threads, then an independent set of collapses (no two
+ * share a triangle or a neighbour) is taken in cost order and
+ * applied in parallel. Collapses that would flip a triangle or
+ * pinch the surface (link condition) are skipped. The result
+ * does not depend on the thread count.
+ ************************************************************/
+
+class QuadricSimplifier
+{
+public:
+	//Same contract as Grid::simplifyMesh, with a triangle budget instead of a resolution: the
+	//result has at most 'targetTriangles' triangles unless no valid collapse is left, and is
+	//centered, scaled and has normals. 'threads' 0 means all cores.
+	Mesh simplifyMesh(const Mesh & mesh, size_t targetTriangles, unsigned int threads = 0);
+	//simplifyMesh without the final centering and scaling, in the frame of 'mesh' (see
+	//Grid::clusterMesh); normals are not computed
+	Mesh collapseMesh(const Mesh & mesh, size_t targetTriangles, unsigned int threads = 0);
+
+	//statistics of the last call
+	unsigned int rounds;
+	size_t collapses;
+};
+
+#endif // QUADRICSIMPLIFIER_H
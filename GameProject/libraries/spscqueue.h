@@ -0,0 +1,60 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+/************************************************************
+ * Single producer, single consumer queue
+ * Fixed capacity ring without locks: one thread only pushes,
+ * one other thread only pops, and neither ever waits for the
+ * other. The producer publishes a slot with a release store of
+ * the tail and the consumer frees it with a release store of
+ * the head, so whatever the producer wrote before push() is
+ * visible to the consumer after pop() (used to hand buffers
+ * between threads, see terraingenerator.h).
+ ************************************************************/
+
+template <typename T>
+class SpscQueue
+{
+public:
+	explicit SpscQueue(size_t capacity) : mSlots(capacity + 1), mHead(0), mTail(0) {}
+
+	//producer thread only; false when the queue is full
+	bool push(const T & value)
+	{
+		size_t tail = mTail.load(std::memory_order_relaxed);
+		size_t next = tail + 1 == mSlots.size() ? 0 : tail + 1;
+		if (next == mHead.load(std::memory_order_acquire))
+			return false;
+		mSlots[tail] = value;
+		mTail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	//consumer thread only; false when the queue is empty
+	bool pop(T & value)
+	{
+		size_t head = mHead.load(std::memory_order_relaxed);
+		if (head == mTail.load(std::memory_order_acquire))
+			return false;
+		value = mSlots[head];
+		mHead.store(head + 1 == mSlots.size() ? 0 : head + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	SpscQueue(const SpscQueue &);
+	SpscQueue & operator=(const SpscQueue &);
+
+	std::vector<T> mSlots;
+	//each is written by one thread only: the padding keeps them 64 bytes apart, so never on the
+	//same cache line, without over-aligning the queue (plain new only aligns to 16 before C++17)
+	std::atomic<size_t> mHead;
+	char mPadding[64 - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> mTail;
+};
+
+#endif // SPSCQUEUE_H
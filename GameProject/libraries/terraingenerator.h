@@ -0,0 +1,94 @@
+#ifndef TERRAINGENERATOR_H
+#define TERRAINGENERATOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include "ModelVertex.h"
+#include "spscqueue.h"
+
+/************************************************************
+ * Procedural terrain in chunks
+ * The heights of row i, column j of the endless terrain come
+ * from gradient noise of (j, i) with a few octaves, mixed with
+ * some detail from a random generator seeded with the seed and
+ * the row. Every vertex is a function of the seed and its place
+ * only, so chunks can be made in any order, on any thread, and
+ * still join without seams.
+ *
+ * A chunk is 'chunkRows' rows of 'columns' vertices, ready to
+ * draw: positions (z is the row), normals from the triangles of
+ * the rows around it and shadows swept over the chunk and the
+ * rows on either side the light can reach (terrainshadow.h),
+ * which are the shadows of the whole terrain from row 0 on.
+ *
+ * TerrainGenerator makes the chunks ahead of the scrolling on a
+ * worker thread and hands them to the main thread through a
+ * lock-free queue; the used ones go back through a second queue
+ * to be filled again, so the main thread neither waits for the
+ * generation nor allocates or frees chunk memory. A side that
+ * finds its queue empty sleeps on a condition variable until
+ * the other side pushes (or the generator stops), instead of
+ * polling.
+ ************************************************************/
+
+struct TerrainSettings
+{
+	int columns;
+	int chunkRows;
+	uint32_t seed;
+	glm::vec3 lightDir; //from the light into the scene
+};
+
+struct TerrainChunk
+{
+	int firstRow;
+	//chunkRows * columns, row major; texCoor.y is left to the terrain drawing them
+	std::vector<terrainVertex> vertices;
+};
+
+//The 'columns' heights of row 'row', between 0 and 1
+void terrainRowHeights(uint32_t seed, int row, int columns, float * heights);
+
+//Fills 'chunk' with the rows from chunkIndex * chunkRows on
+void generateTerrainChunk(const TerrainSettings & settings, int chunkIndex, TerrainChunk & chunk);
+
+class TerrainGenerator
+{
+public:
+	//starts the worker, which keeps up to 'prefetchChunks' chunks made ahead
+	explicit TerrainGenerator(const TerrainSettings & settings, int prefetchChunks = 4);
+	~TerrainGenerator();
+
+	//Main thread: the next row of the terrain, from row 0 on, 'columns' vertices valid until the
+	//next call. Only waits when the worker is a whole prefetch behind the scrolling.
+	const terrainVertex * nextRow();
+
+	const TerrainSettings & settings() const { return mSettings; }
+
+private:
+	void workerLoop();
+
+	TerrainGenerator(const TerrainGenerator &);
+	TerrainGenerator & operator=(const TerrainGenerator &);
+
+	TerrainSettings mSettings;
+	std::vector<std::unique_ptr<TerrainChunk> > mChunks; //owns every chunk buffer
+	SpscQueue<TerrainChunk *> mReady; //worker to main thread, in row order
+	SpscQueue<TerrainChunk *> mSpent; //main thread to worker, to be filled again
+	TerrainChunk * mCurrent;          //chunk nextRow() reads from
+	int mCurrentRow;
+	//only taken to sleep on an empty queue and to wake the other side after a push
+	std::mutex mMutex;
+	std::condition_variable mChunkReady; //mReady got a chunk
+	std::condition_variable mChunkSpent; //mSpent got a chunk, or mStop was set
+	std::atomic<bool> mStop;
+	std::thread mWorker;
+};
+
+#endif // TERRAINGENERATOR_H
@@ -0,0 +1,62 @@
+#ifndef TERRAINSHADOW_H
+#define TERRAINSHADOW_H
+
+#include <vector>
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+/************************************************************
+ * Terrain shadows by horizon sweep
+ * The terrain is the heightfield Terrain draws: vertex (row i,
+ * column j) at (j, height, i), quads split along the diagonal
+ * from (i, j) to (i + 1, j + 1), rows repeating every 'rows'
+ * (the last strip joins the last row to the first one) and no
+ * terrain left or right of the columns. A vertex is in shadow
+ * when the ray from it towards the light passes below the
+ * surface somewhere.
+ *
+ * Instead of casting that ray against every quad, lines parallel
+ * to the light are swept one row (or column) at a time, starting
+ * on the side of the light, with a running horizon: the highest
+ * the surface further along the line reaches, lowered by how much
+ * the ray climbs to get there. A vertex is shadowed when the
+ * horizon at it is above its height, unless the ray stays under
+ * the surface all the way to the border and leaves through the
+ * open side (tracked the same way with the lowest the surface
+ * reaches). Every vertex is visited a
+ * constant number of times, so a rows x columns terrain costs
+ * O(rows * columns) instead of O((rows * columns)^2).
+ *
+ * Lights whose direction projected on the ground is along the
+ * rows, the columns or a diagonal (the game light is (0, -1, 1))
+ * keep every line on vertices, and the result is exactly that of
+ * the ray cast. Other directions interpolate the horizon between
+ * neighbouring lines.
+ ************************************************************/
+
+//'heights' is row major, rows * columns; 'lightDir' points from the light into the scene.
+//shadowed[i * columns + j] is 1 for the vertices in shadow. With 'rowsRepeat' false the
+//terrain ends after the last row like it does after the last column.
+void terrainShadows(const float * heights, int columns, int rows, const glm::vec3 & lightDir,
+	std::vector<uint8_t> & shadowed, bool rowsRepeat = true);
+
+//Exact ray cast, the reference the sweep has to match for the exact lights: the ray from every
+//vertex, both ways along the rows, against both triangles of every quad of one repetition of the
+//rows on either side, placed where Terrain draws them, except the triangles the vertex is a
+//corner of. The triangle borders get a 1e-5 tolerance so rays along the edges cannot slip
+//between two triangles. This is not the original Terrain::computeShadow, see below.
+void terrainShadowsRayCast(const float * heights, int columns, int rows, const glm::vec3 & lightDir,
+	std::vector<uint8_t> & shadowed);
+
+//The shadow loop of the original Terrain::computeShadow, unchanged, kept so tools/shadowbench can
+//report where the sweep differs from it. It only casts against the strips from the vertex on,
+//counts a hit at the origin of the ray, and leaves the strip from the last row to the first one
+//spanning the whole terrain backwards instead of after the last row.
+void terrainShadowsBaseline(const float * heights, int columns, int rows, const glm::vec3 & lightDir,
+	std::vector<uint8_t> & shadowed);
+
+//How many rows away a vertex can shadow another one, at most 'maxRows', when the heights span
+//'heightRange': past that the ray towards the light is above all the terrain
+int terrainShadowReach(const glm::vec3 & lightDir, float heightRange, int maxRows);
+
+#endif // TERRAINSHADOW_H
@@ -0,0 +1,49 @@
+#ifndef VERTEXLAYOUT_H
+#define VERTEXLAYOUT_H
+
+#include <vector>
+
+//what an attribute means, used by code that has to interpret vertex data generically
+enum VertexSemantic
+{
+	SEMANTIC_POSITION = 0,
+	SEMANTIC_NORMAL = 1,
+	SEMANTIC_TEXCOORD = 2,
+	SEMANTIC_COLOR = 3
+};
+
+//one float attribute of an interleaved vertex
+struct VertexAttribute
+{
+	unsigned int location;   //shader input location
+	unsigned int components; //number of floats
+	unsigned int offset;     //byte offset inside the vertex
+	unsigned int semantic;   //VertexSemantic
+};
+
+//description of an interleaved vertex struct
+struct VertexLayout
+{
+	unsigned int stride;
+	std::vector<VertexAttribute> attributes;
+
+	bool operator==(const VertexLayout & other) const
+	{
+		if (stride != other.stride || attributes.size() != other.attributes.size())
+			return false;
+		for (size_t i = 0; i < attributes.size(); i++)
+		{
+			const VertexAttribute & a = attributes[i];
+			const VertexAttribute & b = other.attributes[i];
+			if (a.location != b.location || a.components != b.components || a.offset != b.offset || a.semantic != b.semantic)
+				return false;
+		}
+		return true;
+	}
+	bool operator!=(const VertexLayout & other) const { return !(*this == other); }
+};
+
+//specialised for every vertex struct that goes through generic code (see ModelVertex.h)
+template <typename T> VertexLayout vertexLayout();
+
+#endif // VERTEXLAYOUT_H
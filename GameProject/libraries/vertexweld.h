@@ -0,0 +1,66 @@
+#ifndef VERTEXWELD_H
+#define VERTEXWELD_H
+
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+
+/************************************************************
+ * Vertex welding
+ * Turns a triangle list (3 vertices per triangle) into unique
+ * vertices plus an index buffer. Two vertices are merged only
+ * if all their bytes are equal, so every attribute (including
+ * the morph target poses) is kept exactly. The vertex struct
+ * must not contain padding (all our vertex structs are floats).
+ ************************************************************/
+
+//hash of the raw 32 bit words of a vertex
+inline uint64_t hashVertexBytes(const void * vertex, size_t size)
+{
+	const unsigned char * bytes = reinterpret_cast<const unsigned char *>(vertex);
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i + 4 <= size; i += 4)
+	{
+		uint32_t word;
+		memcpy(&word, bytes + i, 4);
+		hash = (hash ^ word) * 1099511628211ull;
+	}
+	//final avalanche, the table index comes from the low bits
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+//replace 'vertices' by its unique vertices (in order of first use) and fill 'indices', returns the vertex count
+template <typename T>
+size_t weldVertices(std::vector<T> & vertices, std::vector<uint32_t> & indices)
+{
+	const uint32_t EMPTY = 0xffffffffu;
+	size_t tableSize = 16;
+	while (tableSize < vertices.size() * 2)
+		tableSize *= 2;
+	//open addressing with linear probing, the table stores indices into 'unique'
+	std::vector<uint32_t> table(tableSize, EMPTY);
+	std::vector<T> unique;
+	unique.reserve(vertices.size() / 2);
+	indices.resize(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const T & vertex = vertices[i];
+		size_t slot = size_t(hashVertexBytes(&vertex, sizeof(T))) & (tableSize - 1);
+		while (table[slot] != EMPTY && memcmp(&unique[table[slot]], &vertex, sizeof(T)) != 0)
+			slot = (slot + 1) & (tableSize - 1);
+		if (table[slot] == EMPTY)
+		{
+			table[slot] = uint32_t(unique.size());
+			unique.push_back(vertex);
+		}
+		indices[i] = table[slot];
+	}
+	vertices.swap(unique);
+	return vertices.size();
+}
+
+#endif // VERTEXWELD_H
@@ -0,0 +1,141 @@
+#include "lodasset.h"
+#include "meshcache.h"
+#include "mesh.h"
+#include "grid.h"
+#include "clustering.h"
+#include "meshdistance.h"
+#include "quadricsimplifier.h"
+#include "parallel.h"
+#include <iostream>
+
+uint64_t LodAsset::parameters() const
+{
+	uint64_t hash = hashParameters(0, &levelOffset[0], sizeof(float) * 3);
+	if (!resolutions.empty())
+		hash = hashParameters(hash, &resolutions[0], resolutions.size() * sizeof(unsigned int));
+	if (!maxErrors.empty())
+		hash = hashParameters(hash, &maxErrors[0], maxErrors.size() * sizeof(float));
+	//the grid engine hashes as before the engines existed, so its caches stay valid
+	if (engine == SIMPLIFY_GRID)
+		return hash;
+	hash = hashParameters(hash, &engine, sizeof(engine));
+	return triangleRatios.empty() ? hash : hashParameters(hash, &triangleRatios[0], triangleRatios.size() * sizeof(float));
+}
+
+LodAsset bossDamageAsset()
+{
+	LodAsset asset;
+	asset.name = "boss damage";
+	asset.cacheFile = "boss_damage.meshcache";
+	asset.sourceFile = "boss.obj";
+	asset.engine = SIMPLIFY_GRID;
+	//DAMAGE1 draws the 70 level, DAMAGE2 the 40 one and DAMAGE3 the 30 one (Boss::update); these
+	//are tuned by eye for the look of the damage, not for an error bound, so no maxErrors here
+	const unsigned int resolutions[] = { 70, 60, 50, 40, 30 };
+	asset.resolutions.assign(resolutions, resolutions + 5);
+	//the simplified shells sit on the body of the textured boss
+	asset.levelOffset = glm::vec3(0.0f, 0.50f, -0.17f);
+	return asset;
+}
+
+//Mesh vertices are already unique, so they map 1:1 to BossVertex and the triangles become the indices
+static void meshVertices(const Mesh & mesh, std::vector<BossVertex> & vertices, std::vector<uint32_t> & indices)
+{
+	vertices.assign(mesh.vertices.size(), BossVertex());
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		vertices[i].pos = glm::vec3(mesh.vertices[i].p[0], mesh.vertices[i].p[1], mesh.vertices[i].p[2]);
+		vertices[i].normal = glm::vec3(mesh.vertices[i].n[0], mesh.vertices[i].n[1], mesh.vertices[i].n[2]);
+	}
+	indices.resize(3 * mesh.triangles.size());
+	for (size_t i = 0; i < mesh.triangles.size(); i++)
+	{
+		for (int v = 0; v < 3; v++)
+			indices[3 * i + v] = mesh.triangles[i].v[v];
+	}
+}
+
+bool bakeLodAsset(const LodAsset & asset, std::vector<BossVertex> & vertices, std::vector<uint32_t> & indices,
+	std::vector<LodLevel> & levels, std::string & error, MeshOptimizeReport * report)
+{
+	Mesh mesh;
+	if (!mesh.loadMesh(asset.sourceFile))
+	{
+		error = std::string(asset.sourceFile) + ": cannot load the mesh";
+		return false;
+	}
+	optimizeMesh(mesh, report);
+	std::vector<MeshSoA> simplified;
+	if (asset.engine == SIMPLIFY_QUADRIC)
+	{
+		//every level from the source mesh, each collapse run is multi-threaded itself
+		simplified.resize(asset.triangleRatios.size());
+		for (size_t i = 0; i < asset.triangleRatios.size(); i++)
+		{
+			QuadricSimplifier simplifier;
+			size_t target = size_t(asset.triangleRatios[i] * mesh.triangles.size());
+			simplified[i].fromMesh(simplifier.simplifyMesh(mesh, target));
+		}
+	}
+	else
+	{
+		std::vector<unsigned int> resolutions = asset.resolutions;
+		if (!asset.maxErrors.empty())
+		{
+			resolutions.clear();
+			for (size_t i = 0; i < asset.maxErrors.size(); i++)
+				resolutions.push_back(resolutionForError(mesh, asset.maxErrors[i]));
+		}
+
+		//all simplified levels come from one clustering pass, then every level is converted on its own
+		Grid grid;
+		grid.simplifyMeshLevels(mesh, resolutions, simplified);
+	}
+	std::vector<std::vector<BossVertex> > levelVertices(simplified.size() + 1);
+	std::vector<std::vector<uint32_t> > levelIndices(simplified.size() + 1);
+	meshVertices(mesh, levelVertices[0], levelIndices[0]);
+	parallelFor(0, simplified.size(), [&](size_t first, size_t last, unsigned int) {
+		for (size_t i = first; i < last; i++)
+		{
+			MeshSoA & level = simplified[i];
+			for (size_t v = 0; v < level.vertexCount(); v++)
+			{
+				level.px[v] += asset.levelOffset.x;
+				level.py[v] += asset.levelOffset.y;
+				level.pz[v] += asset.levelOffset.z;
+			}
+			::levelVertices(level, levelVertices[i + 1], levelIndices[i + 1]);
+			optimizeMesh(levelVertices[i + 1], levelIndices[i + 1]);
+		}
+	}, 0, 1);
+
+	vertices.clear();
+	indices.clear();
+	levels.clear();
+	for (size_t l = 0; l < levelVertices.size(); l++)
+	{
+		uint32_t base = uint32_t(vertices.size());
+		LodLevel range = { uint32_t(indices.size()), uint32_t(levelIndices[l].size()), 0.0f };
+		vertices.insert(vertices.end(), levelVertices[l].begin(), levelVertices[l].end());
+		for (size_t i = 0; i < levelIndices[l].size(); i++)
+			indices.push_back(base + levelIndices[l][i]);
+		levels.push_back(range);
+	}
+	return true;
+}
+
+bool loadLodAsset(const LodAsset & asset, std::vector<BossVertex> & vertices, std::vector<uint32_t> & indices,
+	std::vector<LodLevel> & levels)
+{
+	return loadCachedMesh(asset.cacheFile, std::vector<std::string>(1, asset.sourceFile), asset.parameters(),
+		vertices, indices, levels,
+		[&asset](std::vector<BossVertex> & bakedVertices, std::vector<uint32_t> & bakedIndices, std::vector<LodLevel> & bakedLevels) {
+		std::string error;
+		if (!bakeLodAsset(asset, bakedVertices, bakedIndices, bakedLevels, error))
+		{
+			std::cerr << error << std::endl;
+			return false;
+		}
+		return true;
+	});
+}
@@ -0,0 +1,259 @@
+#include "lodchain.h"
+#include "clustering.h"
+#include <algorithm>
+#include <cmath>
+
+int selectLodLevel(const LodChain & chain, float projectedRadius, int current, float maxPixelError, float hysteresis)
+{
+	int count = int(chain.levels.size());
+	if (count <= 1 || chain.radius <= 0.0f)
+		return 0;
+	current = std::min(std::max(current, 0), count - 1);
+	//on screen size of the cells of a level
+	float pixelsPerUnit = projectedRadius / chain.radius;
+
+	//coarsest level that is clearly good enough
+	int coarser = 0;
+	for (int l = 1; l < count; l++)
+	{
+		if (chain.levels[l].error * pixelsPerUnit <= maxPixelError * (1.0f - hysteresis))
+			coarser = l;
+	}
+	if (coarser >= current)
+		return coarser;
+
+	//keep the current level while it is not clearly too coarse
+	if (chain.levels[current].error * pixelsPerUnit <= maxPixelError * (1.0f + hysteresis))
+		return current;
+	int finer = 0;
+	for (int l = 1; l < current; l++)
+	{
+		if (chain.levels[l].error * pixelsPerUnit <= maxPixelError)
+			finer = l;
+	}
+	return finer;
+}
+
+float lodBoundingRadius(const float * vertices, size_t vertexCount, const VertexLayout & layout)
+{
+	size_t floatsPerVertex = layout.stride / sizeof(float);
+	float radius2 = 0.0f;
+	for (size_t a = 0; a < layout.attributes.size(); a++)
+	{
+		const VertexAttribute & attribute = layout.attributes[a];
+		if (attribute.semantic != SEMANTIC_POSITION || attribute.components < 3)
+			continue;
+		const float * p = vertices + attribute.offset / sizeof(float);
+		for (size_t i = 0; i < vertexCount; i++, p += floatsPerVertex)
+			radius2 = std::max(radius2, p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+	}
+	return std::sqrt(radius2);
+}
+
+//Vertex pairs with the same position and texture coordinates, split only by their normals or
+//morph channels; empty when the layout has no texture coordinates
+static void textureTwins(const float * vertices, size_t vertexCount, const VertexLayout & layout, size_t positionOffset,
+	std::vector<std::pair<uint32_t, uint32_t> > & twins)
+{
+	size_t floatsPerVertex = layout.stride / sizeof(float);
+	std::vector<size_t> keyOffsets(1, positionOffset);
+	std::vector<unsigned int> keyComponents(1, 3);
+	for (size_t a = 0; a < layout.attributes.size(); a++)
+	{
+		if (layout.attributes[a].semantic != SEMANTIC_TEXCOORD)
+			continue;
+		keyOffsets.push_back(layout.attributes[a].offset / sizeof(float));
+		keyComponents.push_back(layout.attributes[a].components);
+	}
+	twins.clear();
+	if (keyOffsets.size() == 1)
+		return;
+
+	std::vector<float> keys;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float * v = vertices + i * floatsPerVertex;
+		for (size_t k = 0; k < keyOffsets.size(); k++)
+			keys.insert(keys.end(), v + keyOffsets[k], v + keyOffsets[k] + keyComponents[k]);
+	}
+	size_t keySize = keys.size() / vertexCount;
+	std::vector<uint32_t> order(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+		order[i] = uint32_t(i);
+	auto less = [&keys, keySize](uint32_t a, uint32_t b) {
+		return std::lexicographical_compare(&keys[a * keySize], &keys[a * keySize] + keySize, &keys[b * keySize], &keys[b * keySize] + keySize);
+	};
+	std::sort(order.begin(), order.end(), less);
+	for (size_t i = 1; i < vertexCount; i++)
+	{
+		if (!less(order[i - 1], order[i]))
+			twins.push_back(std::make_pair(order[i - 1], order[i]));
+	}
+}
+
+//UV islands inside the cells of a level: vertices of a cell are joined by the triangle edges
+//that stay in the cell and by being twins. The two sides of a UV seam through a cell are only
+//connected around the seam, outside of it, so they end up in different islands. island[i] is
+//the smallest vertex of the island of vertex i.
+static void cellIslands(const VertexClusters & level, const uint32_t * indices, size_t indexCount,
+	const std::vector<std::pair<uint32_t, uint32_t> > & twins, std::vector<uint32_t> & island)
+{
+	size_t vertexCount = level.vertexCluster.size();
+	island.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+		island[i] = uint32_t(i);
+	auto root = [&island](uint32_t v) {
+		while (island[v] != v)
+			v = island[v] = island[island[v]];
+		return v;
+	};
+	auto join = [&island, &root](uint32_t a, uint32_t b) {
+		a = root(a);
+		b = root(b);
+		if (a != b)
+			island[std::max(a, b)] = std::min(a, b);
+	};
+	for (size_t i = 0; i < twins.size(); i++)
+		join(twins[i].first, twins[i].second);
+	for (size_t t = 0; t + 2 < indexCount; t += 3)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			uint32_t a = indices[t + e], b = indices[t + (e + 1) % 3];
+			if (level.vertexCluster[a] == level.vertexCluster[b])
+				join(a, b);
+		}
+	}
+	for (size_t i = 0; i < vertexCount; i++)
+		island[i] = root(uint32_t(i));
+}
+
+void clusterInterleavedLevels(const float * vertices, size_t vertexCount, const VertexLayout & layout,
+	const uint32_t * indices, size_t indexCount, const std::vector<unsigned int> & resolutions,
+	std::vector<std::vector<float> > & levelVertices, std::vector<std::vector<uint32_t> > & levelIndices,
+	std::vector<float> & errors)
+{
+	levelVertices.assign(resolutions.size(), std::vector<float>());
+	levelIndices.assign(resolutions.size(), std::vector<uint32_t>());
+	errors.assign(resolutions.size(), 0.0f);
+	size_t floatsPerVertex = layout.stride / sizeof(float);
+	size_t positionOffset = layout.attributes.size();
+	for (size_t a = 0; a < layout.attributes.size() && positionOffset == layout.attributes.size(); a++)
+	{
+		if (layout.attributes[a].semantic == SEMANTIC_POSITION)
+			positionOffset = layout.attributes[a].offset / sizeof(float);
+	}
+	if (vertexCount == 0 || positionOffset == layout.attributes.size())
+		return;
+
+	//grid over the bounding cube of the positions, with a margin of 1% on every side
+	std::vector<Vertex> positions(vertexCount);
+	Vec3Df minPoint(vertices[positionOffset], vertices[positionOffset + 1], vertices[positionOffset + 2]);
+	Vec3Df maxPoint = minPoint;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float * p = vertices + i * floatsPerVertex + positionOffset;
+		positions[i].p = Vec3Df(p[0], p[1], p[2]);
+		for (int k = 0; k < 3; k++)
+		{
+			minPoint[k] = std::min(minPoint[k], p[k]);
+			maxPoint[k] = std::max(maxPoint[k], p[k]);
+		}
+	}
+	float edge = std::max(std::max(maxPoint[0] - minPoint[0], maxPoint[1] - minPoint[1]), maxPoint[2] - minPoint[2]);
+	float margin = edge > 0.0f ? 0.01f * edge : 0.5f;
+	Vec3Df origin = minPoint - Vec3Df(margin, margin, margin);
+	float size = edge + 2.0f * margin;
+
+	std::vector<VertexClusters> clusters;
+	clusterVertexLevels(positions, origin, size, resolutions, clusters);
+	std::vector<std::pair<uint32_t, uint32_t> > twins;
+	textureTwins(vertices, vertexCount, layout, positionOffset, twins);
+	bool textured = false;
+	//texture coordinates are averaged per island, everything else per cell
+	std::vector<bool> perIsland(floatsPerVertex, false);
+	for (size_t a = 0; a < layout.attributes.size(); a++)
+	{
+		if (layout.attributes[a].semantic != SEMANTIC_TEXCOORD)
+			continue;
+		std::vector<bool>::iterator first = perIsland.begin() + layout.attributes[a].offset / sizeof(float);
+		std::fill(first, first + layout.attributes[a].components, true);
+		textured = true;
+	}
+	std::vector<uint32_t> island(vertexCount, 0);
+
+	for (size_t l = 0; l < resolutions.size(); l++)
+	{
+		const VertexClusters & level = clusters[l];
+		size_t clusterCount = level.counts.size();
+		errors[l] = size / resolutions[l];
+
+		//one output vertex per island of a cell, so the two sides of a UV seam keep their own
+		//texture coordinates while sharing the position, normal and morph channels of the cell
+		if (textured)
+			cellIslands(level, indices, indexCount, twins, island);
+		std::vector<uint64_t> keys(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+			keys[i] = (uint64_t(level.vertexCluster[i]) << 32) | island[i];
+		std::vector<uint64_t> outputKeys(keys);
+		std::sort(outputKeys.begin(), outputKeys.end());
+		outputKeys.erase(std::unique(outputKeys.begin(), outputKeys.end()), outputKeys.end());
+		std::vector<uint32_t> output(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+			output[i] = uint32_t(std::lower_bound(outputKeys.begin(), outputKeys.end(), keys[i]) - outputKeys.begin());
+
+		//mean of every float of the vertices of a cell, and of an island
+		std::vector<float> cellMean(clusterCount * floatsPerVertex, 0.0f);
+		std::vector<float> & out = levelVertices[l];
+		out.assign(outputKeys.size() * floatsPerVertex, 0.0f);
+		std::vector<uint32_t> outputCounts(outputKeys.size(), 0);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			float * cellSum = &cellMean[level.vertexCluster[i] * floatsPerVertex];
+			float * sum = &out[output[i] * floatsPerVertex];
+			const float * v = vertices + i * floatsPerVertex;
+			for (size_t k = 0; k < floatsPerVertex; k++)
+			{
+				cellSum[k] += v[k];
+				sum[k] += v[k];
+			}
+			outputCounts[output[i]]++;
+		}
+		for (size_t o = 0; o < outputKeys.size(); o++)
+		{
+			float * v = &out[o * floatsPerVertex];
+			const float * cell = &cellMean[(outputKeys[o] >> 32) * floatsPerVertex];
+			float cellScale = 1.0f / float(level.counts[outputKeys[o] >> 32]);
+			float scale = 1.0f / float(outputCounts[o]);
+			for (size_t k = 0; k < floatsPerVertex; k++)
+				v[k] = perIsland[k] ? v[k] * scale : cell[k] * cellScale;
+			for (size_t a = 0; a < layout.attributes.size(); a++)
+			{
+				if (layout.attributes[a].semantic != SEMANTIC_NORMAL || layout.attributes[a].components != 3)
+					continue;
+				float * n = v + layout.attributes[a].offset / sizeof(float);
+				float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length > 0.0f)
+				{
+					n[0] /= length;
+					n[1] /= length;
+					n[2] /= length;
+				}
+			}
+		}
+
+		//triangles between three different cells
+		std::vector<uint32_t> & triangles = levelIndices[l];
+		for (size_t t = 0; t + 2 < indexCount; t += 3)
+		{
+			uint32_t c0 = level.vertexCluster[indices[t]];
+			uint32_t c1 = level.vertexCluster[indices[t + 1]];
+			uint32_t c2 = level.vertexCluster[indices[t + 2]];
+			if (c0 == c1 || c1 == c2 || c0 == c2)
+				continue;
+			triangles.push_back(output[indices[t]]);
+			triangles.push_back(output[indices[t + 1]]);
+			triangles.push_back(output[indices[t + 2]]);
+		}
+	}
+}
@@ -25,18 +25,25 @@
 #include "camera.h"
 
 #include <iostream>
+#include <cstdio>
 #include <fstream>
 #include <sstream>
+#include <chrono>
+#include <memory>
 
 #include "Model.h"
 #include "Vec3D.h"
 #include "mesh.h"
 #include "grid.h"
+#include "clustering.h"
+#include "morphtargets.h"
+#include "assetloader.h"
+#include "meshoptimize.h"
+#include "lodchain.h"
+#include "lodasset.h"
 
 
-Mesh mesh;
 Mesh simplified;
-Grid grid;
 
 bool lightView = false;
 
@@ -74,25 +81,6 @@ Terrain terrain(20, 20, lightDir);
 const int WIDTH = 600;
 const int HEIGHT = 800;
 
-std::vector<BossVertex> formatMeshVertices(std::vector<Vertex> vertices, std::vector<Triangle> triangles)
-{
-	std::vector<BossVertex> bossVertices;
-	for (int i=0;i<triangles.size();++i)
-	{
-	    for(int v = 0; v < 3 ; v++){
-			BossVertex vertex;
-			glm::vec3 pos, normal;
-			normal = { vertices[triangles[i].v[v]].n[0], vertices[triangles[i].v[v]].n[1], vertices[triangles[i].v[v]].n[2] };
-			pos = { vertices[triangles[i].v[v]].p[0], vertices[triangles[i].v[v]].p[1] , vertices[triangles[i].v[v]].p[2] };
-			vertex.pos = pos;
-			vertex.normal = normal;
-			bossVertices.push_back(vertex);
-	    }
-	
-	}
-	return bossVertices;
-}
-
 struct Mouse
 {
 	glm::vec2 screenCoor;// screen coordinates (left,bottom)(0,0) -> (right,top)(1,1)
@@ -270,21 +258,12 @@ void initBoss(Boss &boss)
 	boss.safeDistance = 2.0;
 	boss.coolDownTime = 3.0;
 	boss.mixFactor.increment = 0.05;
-	mesh.loadMesh("boss.obj");
-	boss.vertices = formatMeshVertices(mesh.vertices, mesh.triangles);
-	boss.simplifiedVertices.push_back(boss.vertices);
-		
-	for (int i = 0; i < 5; i++)
-	{
-		Mesh simplified;
-		simplified = grid.simplifyMesh(mesh, 70 - i * 10);
-		for (int y = 0; y < simplified.vertices.size(); y++) {
-			simplified.vertices[y].p[1] += 0.50;
-			simplified.vertices[y].p[2] -= 0.17;
-		}
+}
 
-		boss.simplifiedVertices.push_back(formatMeshVertices(simplified.vertices, simplified.triangles));
-	}	
+// load the damage levels of the boss, baked by tools/lodbake (or here when the cache is stale)
+bool readBossMesh(Boss &boss)
+{
+	return loadLodAsset(bossDamageAsset(), boss.vertices, boss.indices, boss.damageLod.levels);
 }
 
 void initIcicles(std::vector<Shape> &icicles)
@@ -322,7 +301,7 @@ void initIcicles(std::vector<Shape> &icicles)
 		shape.points.push_back(vertex);
 	}
 	shape.indices = { 0,1,4,1,2,3,1,3,4 };
-	shape.vertices = shape.generateVertices();
+	shape.vertices = shape.points;
 
 	for(int i = 0; i < 5; i++)
 	{
@@ -363,7 +342,7 @@ void initLifeCrystal(Shape &shape)
 		shape.points.push_back(vertex);
 	}
 	shape.indices = { 0,1,3,1,2,3 };
-	shape.vertices = shape.generateVertices();
+	shape.vertices = shape.points;
 }
 
 void initLifeCrystals(std::vector<Shape> &crystals)
@@ -416,7 +395,7 @@ void initFlame(Shape &shape)
 		shape.points.push_back(vertex);
 	}
 	shape.indices = { 0,1,2,0,2,3,0,3,4,0,4,5,0,5,6,0,6,7 };
-	shape.vertices = shape.generateVertices();
+	shape.vertices = shape.points;
 }
 
 void initFlames(std::vector<Shape> &flames)
@@ -437,51 +416,29 @@ void initIceBerg(Model &iceBerg)
 	iceBerg.position = { 0,1,2.8 };
 }
 
-int loadIceBerg(IceBerg &iceBerg)
+void initTerrain(Terrain &terrain)
 {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string err;
-	//load
-	{
-		int vertexCounter = 0;
-		// load initial pose
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "iceberg.obj")) {
-			std::cerr << err << std::endl;
-			return EXIT_FAILURE;
-		}
-		// Read triangle vertices from OBJ file
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				EnemyVertex vertex = {};
-
-				// Retrieve coordinates for vertex by index
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				// Retrieve components of normal by index
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-
-				// Retrieve coordinates for texture
-				vertex.texCoor = {
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					attrib.texcoords[2 * index.texcoord_index + 1]
-				};
-
-				iceBerg.vertices.push_back(vertex);
-			}
-		}
+	terrain.generateTerrain();
+}
+
+// a missing image only costs the texture: the geometry is still uploaded and drawn
+void decodeTextureOrWarn(Model &model, const char *fileName)
+{
+	if (!model.decodeTexture(fileName))
+		std::cerr << "Failed to load texture " << fileName << "!" << std::endl;
+}
+
+bool readIceBerg(IceBerg &iceBerg)
+{
+	decodeTextureOrWarn(iceBerg, "iceberg.jpg");
+	return loadMorphAsset(iceBergAsset(), iceBerg.vertices, iceBerg.indices);
+}
 
+void uploadIceBerg(IceBerg &iceBerg)
+{
+	{
 		// load texture for enemy
-		iceBerg.loadTexture("iceberg.jpg");
+		iceBerg.uploadTexture();
 
 		/////// handle the vertices of enemy
 		{
@@ -503,8 +460,9 @@ int loadIceBerg(IceBerg &iceBerg)
 			glBindBuffer(GL_ARRAY_BUFFER, iceBerg.vbo);
 			glVertexAttribPointer(8, 2, GL_FLOAT, GL_FALSE, sizeof(VertexBasic), reinterpret_cast<void*>(offsetof(VertexBasic, texCoor)));
 			glEnableVertexAttribArray(8);
+
+			iceBerg.ebo.load(iceBerg.indices, iceBerg.vertices.size());
 		}
-		return 0;
 	}
 }
 
@@ -529,146 +487,17 @@ void initEnemies(std::vector<Enemy> &enemies)
 		enemies.push_back(enemy);
 	}
 }
-int loadAnivia(Anivia &anivia)
-{
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string err;
-
-	//load ANIVIA
-	{
-		int vertexCounter = 0;
-		// load initial pose
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "anivia_start.obj")) {
-			std::cerr << err << std::endl;
-			return EXIT_FAILURE;
-		}
-		// Read triangle vertices from OBJ file
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				AniviaVertex vertex = {};
-
-				// Retrieve coordinates for vertex by index
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				// Retrieve components of normal by index
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-
-				// Retrieve coordinates for texture
-				vertex.texCoor = {
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					attrib.texcoords[2 * index.texcoord_index + 1]
-				};
-
-				anivia.vertices.push_back(vertex);
-			}
-		}
-
-		//load idle pose (animation between initial and idle pose)
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "anivia_open_wing.obj")) {
-			std::cerr << err << std::endl;
-			return EXIT_FAILURE;
-		}
-		// Read triangle vertices from OBJ file
-		vertexCounter = 0;
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				VertexBasic vertex = {};
-
-				// Retrieve coordinates for vertex by index
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				// Retrieve components of normal by index
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-
-				anivia.vertices[vertexCounter].pos_idle = vertex.pos;
-				anivia.vertices[vertexCounter].normal_idle = vertex.normal;
-				vertexCounter++;
-			}
-		}
 
-		//load attack pose
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "anivia_attack.obj")) {
-			std::cerr << err << std::endl;
-			return EXIT_FAILURE;
-		}
-		// Read triangle vertices from OBJ file
-		vertexCounter = 0;
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				VertexBasic vertex = {};
-
-				// Retrieve coordinates for vertex by index
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				// Retrieve components of normal by index
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-
-				anivia.vertices[vertexCounter].pos_attack = vertex.pos;
-				anivia.vertices[vertexCounter].normal_attack = vertex.normal;
-				vertexCounter++;
-			}
-		}
-
-		//load idle pose (animation between initial and idle pose)
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "anivia_dead.obj")) {
-			std::cerr << err << std::endl;
-			return EXIT_FAILURE;
-		}
-		// Read triangle vertices from OBJ file
-		vertexCounter = 0;
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				VertexBasic vertex = {};
-
-				// Retrieve coordinates for vertex by index
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				// Retrieve components of normal by index
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-
-				anivia.vertices[vertexCounter].pos_dead = vertex.pos;
-				anivia.vertices[vertexCounter].normal_dead = vertex.normal;
-				vertexCounter++;
-			}
-		}
-	}
+bool readAnivia(Anivia &anivia)
+{
+	decodeTextureOrWarn(anivia, "anivia.png");
+	return loadMorphAsset(aniviaAsset(), anivia.vertices, anivia.indices, anivia.lod);
+}
 
+void uploadAnivia(Anivia &anivia)
+{
 	// load texture for anivia
-	anivia.loadTexture("anivia.png");
+	anivia.uploadTexture();
 
 	/////// handle the vertices of anivia
 	{
@@ -714,118 +543,21 @@ int loadAnivia(Anivia &anivia)
 		glBindBuffer(GL_ARRAY_BUFFER, anivia.vbo);
 		glVertexAttribPointer(8, 2, GL_FLOAT, GL_FALSE, sizeof(AniviaVertex), reinterpret_cast<void*>(offsetof(AniviaVertex, texCoor)));
 		glEnableVertexAttribArray(8);
+
+		anivia.ebo.load(anivia.indices, anivia.vertices.size());
 	}
-	return 0;
 }
-int loadEnemy(Enemy &enemy)
-{
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string err;
-	//load
-	{
-		int vertexCounter = 0;
-		// load initial pose
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "aatrox_low.obj")) {
-			std::cerr << err << std::endl;
-			return EXIT_FAILURE;
-		}
-		// Read triangle vertices from OBJ file
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				EnemyVertex vertex = {};
-
-				// Retrieve coordinates for vertex by index
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				// Retrieve components of normal by index
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-
-				// Retrieve coordinates for texture
-				vertex.texCoor = {
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					attrib.texcoords[2 * index.texcoord_index + 1]
-				};
-
-				enemy.vertices.push_back(vertex);
-			}
-		}
-
-		//load idle pose (animation between initial and idle pose)
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "aatrox_high.obj")) {
-			std::cerr << err << std::endl;
-			return EXIT_FAILURE;
-		}
-		// Read triangle vertices from OBJ file
-		vertexCounter = 0;
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				VertexBasic vertex = {};
-
-				// Retrieve coordinates for vertex by index
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				// Retrieve components of normal by index
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-
-				enemy.vertices[vertexCounter].pos_idle = vertex.pos;
-				enemy.vertices[vertexCounter].normal_idle = vertex.normal;
-				vertexCounter++;
-			}
-		}
-
-		//load dead pose
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "aatrox_dead.obj")) {
-			std::cerr << err << std::endl;
-			return EXIT_FAILURE;
-		}
-		// Read triangle vertices from OBJ file
-		vertexCounter = 0;
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				VertexBasic vertex = {};
-
-				// Retrieve coordinates for vertex by index
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				// Retrieve components of normal by index
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-
-				enemy.vertices[vertexCounter].pos_dead = vertex.pos;
-				enemy.vertices[vertexCounter].normal_dead = vertex.normal;
-				vertexCounter++;
-			}
-		}
 
-	}
+bool readEnemy(Enemy &enemy)
+{
+	decodeTextureOrWarn(enemy, "Aatrox_Base_Mat.png");
+	return loadMorphAsset(enemyAsset(), enemy.vertices, enemy.indices, enemy.lod);
+}
 
+void uploadEnemy(Enemy &enemy)
+{
 	// load texture for enemy
-	enemy.loadTexture("Aatrox_Base_Mat.png");
+	enemy.uploadTexture();
 
 	/////// handle the vertices of enemy
 	{
@@ -863,22 +595,24 @@ int loadEnemy(Enemy &enemy)
 		glBindBuffer(GL_ARRAY_BUFFER, enemy.vbo);
 		glVertexAttribPointer(8, 2, GL_FLOAT, GL_FALSE, sizeof(EnemyVertex), reinterpret_cast<void*>(offsetof(EnemyVertex, texCoor)));
 		glEnableVertexAttribArray(8);
+
+		enemy.ebo.load(enemy.indices, enemy.vertices.size());
 	}
-	return 0;
 }
 
-void loadEnemies(std::vector<Enemy> &enemies)
+// all enemies are the same model: load it once and let the others use its buffers and texture
+void uploadEnemies(std::vector<Enemy> &enemies)
 {
-	for (int i = 0; i < enemies.size(); i++)
+	uploadEnemy(enemies[0]);
+	for (int i = 1; i < enemies.size(); i++)
 	{
-		loadEnemy(enemies[i]);
+		enemies[i].shareGpuData(enemies[0]);
 	}
 }
 
-int loadBoss(Boss &boss)
+void uploadBossMesh(Boss &boss)
 {
-
-	/////// for simplified model
+	/////// for simplified model: every damage level in one buffer
 	{
 		glGenBuffers(1, &boss.vbo);
 		glBindBuffer(GL_ARRAY_BUFFER, boss.vbo);
@@ -894,117 +628,23 @@ int loadBoss(Boss &boss)
 		glBindBuffer(GL_ARRAY_BUFFER, boss.vbo);
 		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(BossVertex), reinterpret_cast<void*>(offsetof(BossVertex, normal)));
 		glEnableVertexAttribArray(1);
-	}
-
 
-	////// LOAD MODEL WITH TEXTURE FOR ANIMATION
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string err;
-	//load
-	{
-		int vertexCounter = 0;
-		// load initial pose
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "boss_low.obj")) {
-			std::cerr << err << std::endl;
-			return EXIT_FAILURE;
-		}
-		// Read triangle vertices from OBJ file
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				BossVertex vertex = {};
-
-				// Retrieve coordinates for vertex by index
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				// Retrieve components of normal by index
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-
-				// Retrieve coordinates for texture
-				vertex.texCoor = {
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					attrib.texcoords[2 * index.texcoord_index + 1]
-				};
-
-				boss.texturedVertices.push_back(vertex);
-			}
-		}
-
-		//load idle pose (animation between initial and idle pose)
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "boss_high.obj")) {
-			std::cerr << err << std::endl;
-			return EXIT_FAILURE;
-		}
-		// Read triangle vertices from OBJ file
-		vertexCounter = 0;
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				VertexBasic vertex = {};
-
-				// Retrieve coordinates for vertex by index
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				// Retrieve components of normal by index
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-
-				boss.texturedVertices[vertexCounter].pos_idle = vertex.pos;
-				boss.texturedVertices[vertexCounter].normal_idle = vertex.normal;
-				vertexCounter++;
-			}
-		}
-
-		//load dead pose
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, "boss_attack.obj")) {
-			std::cerr << err << std::endl;
-			return EXIT_FAILURE;
-		}
-		// Read triangle vertices from OBJ file
-		vertexCounter = 0;
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				VertexBasic vertex = {};
-
-				// Retrieve coordinates for vertex by index
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				// Retrieve components of normal by index
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-
-				boss.texturedVertices[vertexCounter].pos_attack = vertex.pos;
-				boss.texturedVertices[vertexCounter].normal_attack = vertex.normal;
-				vertexCounter++;
-			}
-		}
+		boss.ebo.load(boss.indices, boss.vertices.size());
 	}
+	boss.releaseDamageLevels();
+}
 
+////// LOAD MODEL WITH TEXTURE FOR ANIMATION
+bool readBoss(Boss &boss)
+{
+	decodeTextureOrWarn(boss, "legenddragon-fire.png");
+	return loadMorphAsset(bossAsset(), boss.texturedVertices, boss.texturedIndices, boss.texturedLod);
+}
 
+void uploadBoss(Boss &boss)
+{
 	// load texture for enemy
-	boss.loadTexture("legenddragon-fire.png");
+	boss.uploadTexture();
 
 	/////// handle the vertices of boss
 	{
@@ -1042,17 +682,18 @@ int loadBoss(Boss &boss)
 		glBindBuffer(GL_ARRAY_BUFFER, boss.vbo_tex);
 		glVertexAttribPointer(8, 2, GL_FLOAT, GL_FALSE, sizeof(BossVertex), reinterpret_cast<void*>(offsetof(BossVertex, texCoor)));
 		glEnableVertexAttribArray(8);
+
+		boss.ebo_tex.load(boss.texturedIndices, boss.texturedVertices.size());
 	}
-	return 0;
 }
 
-int loadTerrain(Terrain &terrain)
+void uploadTerrain(Terrain &terrain)
 {
 	////////////////terrain
 	{
 		glGenBuffers(1, &terrain.vbo);
 		glBindBuffer(GL_ARRAY_BUFFER, terrain.vbo);
-		glBufferData(GL_ARRAY_BUFFER, terrain.vertices.size() * sizeof(terrainVertex), terrain.vertices.data(), GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, terrain.vertices.size() * sizeof(terrainVertex), terrain.vertices.data(), GL_DYNAMIC_DRAW);
 
 		glGenVertexArrays(1, &terrain.vao);
 		glBindVertexArray(terrain.vao);
@@ -1072,17 +713,15 @@ int loadTerrain(Terrain &terrain)
 		glBindBuffer(GL_ARRAY_BUFFER, terrain.vbo);
 		glVertexAttribPointer(9, 3, GL_FLOAT, GL_FALSE, sizeof(terrainVertex), reinterpret_cast<void*>(offsetof(terrainVertex, shadow)));
 		glEnableVertexAttribArray(9);
+
+		terrain.ebo.load(terrain.indices, terrain.vertices.size());
 	}
 	// add texture for terrain
-	terrain.loadTexture("terrain.jpg");
-
-	
-	return 0;
+	terrain.uploadTexture();
 }
 
-void loadIcicle(Shape &icicle)
+void uploadIcicle(Shape &icicle)
 {
-	icicle.loadTexture("icicle.png");
 	glGenBuffers(1, &icicle.vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, icicle.vbo);
 	glBufferData(GL_ARRAY_BUFFER, icicle.vertices.size() * sizeof(VertexBasic), icicle.vertices.data(), GL_STATIC_DRAW);
@@ -1101,11 +740,12 @@ void loadIcicle(Shape &icicle)
 	glBindBuffer(GL_ARRAY_BUFFER, icicle.vbo);
 	glVertexAttribPointer(8, 2, GL_FLOAT, GL_FALSE, sizeof(VertexBasic), reinterpret_cast<void*>(offsetof(VertexBasic, texCoor)));
 	glEnableVertexAttribArray(8);
+
+	icicle.ebo.load(icicle.indices, icicle.vertices.size());
 }
 
-void loadCrystal(Shape &crystal)
+void uploadCrystal(Shape &crystal)
 {
-	crystal.loadTexture("icicle.png");
 	glGenBuffers(1, &crystal.vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, crystal.vbo);
 	glBufferData(GL_ARRAY_BUFFER, crystal.vertices.size() * sizeof(VertexBasic), crystal.vertices.data(), GL_STATIC_DRAW);
@@ -1124,12 +764,13 @@ void loadCrystal(Shape &crystal)
 	glBindBuffer(GL_ARRAY_BUFFER, crystal.vbo);
 	glVertexAttribPointer(8, 2, GL_FLOAT, GL_FALSE, sizeof(VertexBasic), reinterpret_cast<void*>(offsetof(VertexBasic, texCoor)));
 	glEnableVertexAttribArray(8);
+
+	crystal.ebo.load(crystal.indices, crystal.vertices.size());
 }
 
 
-void loadFlame(Shape &flame)
+void uploadFlame(Shape &flame)
 {
-	flame.loadTexture("fire2.png");
 	glGenBuffers(1, &flame.vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, flame.vbo);
 	glBufferData(GL_ARRAY_BUFFER, flame.vertices.size() * sizeof(VertexBasic), flame.vertices.data(), GL_STATIC_DRAW);
@@ -1148,6 +789,33 @@ void loadFlame(Shape &flame)
 	glBindBuffer(GL_ARRAY_BUFFER, flame.vbo);
 	glVertexAttribPointer(8, 2, GL_FLOAT, GL_FALSE, sizeof(VertexBasic), reinterpret_cast<void*>(offsetof(VertexBasic, texCoor)));
 	glEnableVertexAttribArray(8);
+
+	flame.ebo.load(flame.indices, flame.vertices.size());
+}
+
+// shapes of one kind use the same image: it is decoded once (into the first shape) and the texture is shared
+void uploadShapes(std::vector<Shape> &shapes, void (*uploadShape)(Shape &))
+{
+	shapes[0].uploadTexture();
+	for (int i = 0; i < shapes.size(); i++)
+	{
+		shapes[i].shareTexture(shapes[0]);
+		uploadShape(shapes[i]);
+	}
+}
+
+// queue the CPU side of loading every asset, the GL uploads are run later by loader.finish()
+void queueAssets(AssetLoader &loader)
+{
+	loader.add([] { return readAnivia(anivia); }, [] { uploadAnivia(anivia); });
+	loader.add([] { return readEnemy(enemies[0]); }, [] { uploadEnemies(enemies); });
+	loader.add([] { decodeTextureOrWarn(terrain, "terrain.jpg"); return true; }, [] { uploadTerrain(terrain); });
+	loader.add([] { decodeTextureOrWarn(icicles[0], "icicle.png"); return true; }, [] { uploadShapes(icicles, uploadIcicle); });
+	loader.add([] { decodeTextureOrWarn(flames[0], "fire2.png"); return true; }, [] { uploadShapes(flames, uploadFlame); });
+	loader.add([] { decodeTextureOrWarn(lifeCrystals[0], "icicle.png"); return true; }, [] { uploadShapes(lifeCrystals, uploadCrystal); });
+	loader.add([] { return readBossMesh(boss); }, [] { uploadBossMesh(boss); });
+	loader.add([] { return readBoss(boss); }, [] { uploadBoss(boss); });
+	loader.add([] { return readIceBerg(iceBerg); }, [] { uploadIceBerg(iceBerg); });
 }
 
 int main() {
@@ -1160,6 +828,12 @@ int main() {
 	initBoss(boss);
 	initEnemies(enemies);
 	initIceBerg(iceBerg);
+	initTerrain(terrain);
+
+	// assets are parsed while the window and the shaders are created
+	std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+	AssetLoader loader;
+	queueAssets(loader);
 
 	if (!glfwInit()) {
 		std::cerr << "Failed to initialize GLFW!" << std::endl;
@@ -1303,28 +977,10 @@ int main() {
 	//std::vector<EnemyVertex> enemyVertices;
 	std::vector<AniviaVertex> aniviaHeadVertices;
 	
-	loadAnivia(anivia);
-	//loadEnemy(enemy);
-	loadEnemies(enemies);
-	loadTerrain(terrain);
-	for (int i = 0; i < icicles.size(); i++)
-	{
-		loadIcicle(icicles[i]);
-	}
-
-	for (int i = 0; i < flames.size(); i++)
-	{
-		loadFlame(flames[i]);
-	}
-
-	for (int i = 0; i < lifeCrystals.size(); i++)
-	{
-		loadCrystal(lifeCrystals[i]);
-	}
-
-
-	loadBoss(boss);
-	loadIceBerg(iceBerg);
+	// upload the assets as they become ready
+	if (!loader.finish())
+		std::cerr << "Failed to load some assets!" << std::endl;
+	std::cout << "Assets loaded in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count() * 1000.0 << " ms" << std::endl;
 
 	//////////////////// Create Vertex Buffer Object
 	GLuint vbo;
@@ -1393,6 +1049,8 @@ int main() {
 
 	StateType lastState = IDLE;
 	double lastShot = glfwGetTime();
+	LodStats lodStats;
+	double lastLodReport = glfwGetTime();
 
 	// Main loop
 	while (!glfwWindowShouldClose(window)) {
@@ -1427,10 +1085,17 @@ int main() {
 		{
 			boss.mixFactor.dead = 0.0;
 		}
-		boss.update(); // update the vertices according to state
+		boss.update(); // pick the damage level of the state
 
 		terrain.update();
 
+		// levels of detail of the characters from their size on screen
+		anivia.updateLod(mainCamera, HEIGHT);
+		for (int i = 0; i < enemies.size(); i++)
+			enemies[i].updateLod(mainCamera, HEIGHT);
+		boss.texturedLodLevel = updateLodLevel(boss.texturedLod, boss.texturedLodLevel, mainCamera,
+			boss.position + glm::vec3(0.0f, -0.5f, -0.1f), 0.22f, HEIGHT);
+
 		//zoom effect after boss death
 		if (boss.state == DEAD) {
 			if(mainCamera.position.y>=9.5){
@@ -1525,7 +1190,7 @@ int main() {
 
 			glBindVertexArray(anivia.vao);
 			anivia.passUniform(shadowProgram);
-			glDrawArrays(GL_TRIANGLES, 0, anivia.vertices.size());
+			anivia.drawLod();
 
 
 			for (int i = 0; i < enemies.size(); i++)
@@ -1533,7 +1198,7 @@ int main() {
 				Enemy &enemy = enemies[i];
 				glBindVertexArray(enemy.vao);
 				enemy.passUniform(shadowProgram);
-				glDrawArrays(GL_TRIANGLES, 0, enemy.vertices.size());
+				enemy.drawLod();
 			}
 
 			for (int j = 0; j < icicles.size(); j++)
@@ -1541,7 +1206,7 @@ int main() {
 				Shape & icicle = icicles[j];
 				glBindVertexArray(icicle.vao);
 				icicle.passUniform(shadowProgram);
-				glDrawArrays(GL_TRIANGLES, 0, icicle.vertices.size());
+				icicle.ebo.draw();
 			}
 
 
@@ -1552,7 +1217,7 @@ int main() {
 			boss.position.y -= 0.5;
 			glBindVertexArray(boss.vao_tex);
 			boss.passUniform(shadowProgram, false, false, false, true);
-			glDrawArrays(GL_TRIANGLES, 0, boss.texturedVertices.size());
+			boss.ebo_tex.draw(boss.texturedLod, boss.texturedLodLevel);
 
 			boss.position.z += 0.1;
 			boss.position.y += 0.5;
@@ -1569,7 +1234,7 @@ int main() {
 				}
 				glBindVertexArray(flame.vao);
 				flame.passUniform(shadowProgram);
-				glDrawArrays(GL_TRIANGLES, 0, flame.vertices.size());
+				flame.ebo.draw();
 				//std::cerr << flame.state;
 			}
 
@@ -1628,7 +1293,7 @@ int main() {
 		
 		glBindVertexArray(anivia.vao);
 		anivia.passUniform(mainProgram);
-		glDrawArrays(GL_TRIANGLES, 0, anivia.vertices.size());
+		anivia.drawLod(&lodStats);
 
 
 		for (int i = 0; i < enemies.size(); i++)
@@ -1636,15 +1301,10 @@ int main() {
 			Enemy &enemy = enemies[i];
 			glBindVertexArray(enemy.vao);
 			enemy.passUniform(mainProgram);
-			glDrawArrays(GL_TRIANGLES, 0, enemy.vertices.size());
+			enemy.drawLod(&lodStats);
 		}
 		
 
-		//// update boss vertices
-		{
-			glBindBuffer(GL_ARRAY_BUFFER, boss.vbo);
-			glBufferSubData(GL_ARRAY_BUFFER, 0, boss.vertices.size() * sizeof(BossVertex), boss.vertices.data());
-		}
 		/*glBindVertexArray(boss.vao);
 		boss.passUniform(mainProgram, true, true, false);
 		glDrawArrays(GL_TRIANGLES, 0, boss.vertices.size());
@@ -1662,7 +1322,7 @@ int main() {
 		if (boss.state != IDLE) {
 			boss.passUniform(mainProgram, true, true, false);
 
-			glDrawArrays(GL_TRIANGLES, 0, boss.vertices.size());
+			boss.ebo.draw(boss.damageLod, boss.damageLevel);
 		}
 		//boss.passUniform(mainProgram, true, true, false);
 
@@ -1673,7 +1333,7 @@ int main() {
 
 		glBindVertexArray(boss.vao_tex);
 		boss.passUniform(mainProgram, false, false, bossHit, true);
-		glDrawArrays(GL_TRIANGLES, 0, boss.texturedVertices.size());
+		boss.ebo_tex.draw(boss.texturedLod, boss.texturedLodLevel, &lodStats);
 
 		
 
@@ -1684,16 +1344,12 @@ int main() {
 		boss.scaleFactor = scaleFactor;
 		boss.position.z += 0.1;
 		boss.position.y += 0.5;
-		// update terrain vertices
-		{
-			glBindBuffer(GL_ARRAY_BUFFER, terrain.vbo);
-			glBufferSubData(GL_ARRAY_BUFFER, 0, terrain.vertices.size() * sizeof(terrainVertex), terrain.vertices.data());
-			//glBindVertexArray(terrain.vao);
-		}
+		// update terrain vertices, only the rows the last scroll step changed
+		terrain.uploadChanges();
 
 		glBindVertexArray(terrain.vao);
 		terrain.passUniform(mainProgram);
-		glDrawArrays(GL_TRIANGLES, 0, terrain.vertices.size());
+		terrain.draw();
 		
 		// update icicle vertices
 		for (int j = 0; j < icicles.size(); j++)
@@ -1711,7 +1367,7 @@ int main() {
 			}
 			glBindVertexArray(icicle.vao);
 			icicle.passUniform(mainProgram);
-			glDrawArrays(GL_TRIANGLES, 0, icicle.vertices.size());
+			icicle.ebo.draw();
 		}
 		
 		// update flame vertices
@@ -1730,7 +1386,7 @@ int main() {
 			}
 			glBindVertexArray(flame.vao);
 			flame.passUniform(mainProgram);
-			glDrawArrays(GL_TRIANGLES, 0, flame.vertices.size());
+			flame.ebo.draw();
 			//std::cerr << flame.state;
 		}
 
@@ -1749,7 +1405,7 @@ int main() {
 			}
 			glBindVertexArray(crystal.vao);
 			crystal.passUniform(mainProgram);
-			glDrawArrays(GL_TRIANGLES, 0, crystal.vertices.size());
+			crystal.ebo.draw();
 			//std::cerr << flame.state;
 		}
 
@@ -1777,11 +1433,23 @@ int main() {
 			break;
 		}
 		iceBerg.passUniform(mainProgram, opacity);
-		glDrawArrays(GL_TRIANGLES, 0, iceBerg.vertices.size());
+		iceBerg.ebo.draw();
 
 		// Present result to the screen
 		glfwSwapBuffers(window);
 
+		// triangles the levels of detail saved in the main pass, about once a second
+		if (lastFrameTime - lastLodReport >= 1.0 && lodStats.fullTriangles > 0)
+		{
+			char title[128];
+			snprintf(title, sizeof(title), "Frozen Flame - characters: %u of %u triangles (%.0f%% saved)",
+				unsigned(lodStats.drawnTriangles), unsigned(lodStats.fullTriangles),
+				100.0 * (1.0 - double(lodStats.drawnTriangles) / double(lodStats.fullTriangles)));
+			glfwSetWindowTitle(window, title);
+			lodStats = LodStats();
+			lastLodReport = lastFrameTime;
+		}
+
 	}
 
 	glDeleteFramebuffers(1, &framebuffer);
@@ -1792,5 +1460,8 @@ int main() {
 	
 	glfwTerminate();
 
+	// stop the terrain worker here rather than in the destructor of the global
+	terrain.generator.reset();
+
     return 0;
 }
\ No newline at end of file
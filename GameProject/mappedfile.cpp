@@ -0,0 +1,123 @@
+#include "mappedfile.h"
+#ifdef WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : mData(0), mSize(0), mOpenEmpty(false)
+#ifdef WIN32
+	, mFile(INVALID_HANDLE_VALUE), mMapping(0)
+#endif
+{}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const char * filename) {
+	close();
+#ifdef WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	return mapHandle(file);
+#else
+	int fd = ::open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+	return mapDescriptor(fd);
+#endif
+}
+
+bool MappedFile::open(FILE * file) {
+	close();
+	if (fflush(file) != 0)
+		return false;
+#ifdef WIN32
+	HANDLE duplicate;
+	HANDLE process = GetCurrentProcess();
+	if (!DuplicateHandle(process, (HANDLE)_get_osfhandle(_fileno(file)), process, &duplicate, 0, FALSE, DUPLICATE_SAME_ACCESS))
+		return false;
+	return mapHandle(duplicate);
+#else
+	int fd = dup(fileno(file));
+	if (fd < 0)
+		return false;
+	return mapDescriptor(fd);
+#endif
+}
+
+#ifdef WIN32
+bool MappedFile::mapHandle(void * file) {
+	mFile = file;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		close();
+		return false;
+	}
+	if (size.QuadPart == 0) {
+		//an empty file cannot be mapped, but it is a valid (empty) file
+		mOpenEmpty = true;
+		return true;
+	}
+	HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping == 0) {
+		close();
+		return false;
+	}
+	mMapping = mapping;
+	mData = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (mData == 0) {
+		close();
+		return false;
+	}
+	mSize = size_t(size.QuadPart);
+	return true;
+}
+#else
+bool MappedFile::mapDescriptor(int fd) {
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		return false;
+	}
+	if (st.st_size == 0) {
+		::close(fd);
+		mOpenEmpty = true;
+		return true;
+	}
+	void * p = mmap(0, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	//the mapping keeps its own reference to the file
+	::close(fd);
+	if (p == MAP_FAILED)
+		return false;
+	madvise(p, size_t(st.st_size), MADV_SEQUENTIAL);
+	mData = static_cast<const char *>(p);
+	mSize = size_t(st.st_size);
+	return true;
+}
+#endif
+
+void MappedFile::close() {
+#ifdef WIN32
+	if (mData)
+		UnmapViewOfFile(mData);
+	if (mMapping)
+		CloseHandle(mMapping);
+	if (mFile != INVALID_HANDLE_VALUE)
+		CloseHandle(mFile);
+	mMapping = 0;
+	mFile = INVALID_HANDLE_VALUE;
+#else
+	if (mData)
+		munmap(const_cast<char *>(mData), mSize);
+#endif
+	mData = 0;
+	mSize = 0;
+	mOpenEmpty = false;
+}
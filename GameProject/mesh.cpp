@@ -1,4 +1,7 @@
 #include "mesh.h"
+#include "objparser.h"
+#include "parallel.h"
+#include "meshsoa.h"
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
@@ -15,77 +18,132 @@ Mesh::Mesh(){}
 using namespace std;
 
 /************************************************************
- * Compute Bounding box
+ * Bounding box, normals and centering, in place on the vertices:
+ * copying the positions into the x/y/z arrays of the meshsoa.h
+ * kernels and back costs more than the kernels save. Only the
+ * weighted normals go through the kernels.
  ************************************************************/
+static_assert(sizeof(Triangle) == 3 * sizeof(uint32_t), "the kernels read Mesh::triangles as index triples");
+
 void Mesh::computeBoundingCube () {
+    if (vertices.empty())
+        return;
     Vec3Df minPoint, maxPoint;
-	minPoint=maxPoint=vertices[0].p;
-	
-    for  (unsigned int i = 1; i < vertices.size (); i++)
-    {
-		for (int j=0;j<3;++j)
-		{
-			minPoint[j] = minPoint[j]< (vertices[i].p)[j] ? minPoint[j]:(vertices[i].p)[j];
-			maxPoint[j] = maxPoint[j]> (vertices[i].p)[j] ? maxPoint[j]:(vertices[i].p)[j];
-		}
-	}
-	
-	//set boundind box origin to minimum corner
-	bbOrigin=minPoint;
-
-	//compute extent of the mesh
-	maxPoint-=minPoint;
-	bbEdgeSize=max(max(maxPoint[0],maxPoint[1]),maxPoint[2]);
+    minPoint = maxPoint = vertices[0].p;
+    for (size_t i = 1; i < vertices.size(); i++) {
+        for (int j = 0; j < 3; ++j) {
+            minPoint[j] = minPoint[j] < vertices[i].p[j] ? minPoint[j] : vertices[i].p[j];
+            maxPoint[j] = maxPoint[j] > vertices[i].p[j] ? maxPoint[j] : vertices[i].p[j];
+        }
+    }
+    bbOrigin = minPoint;
+    maxPoint -= minPoint;
+    bbEdgeSize = max(max(maxPoint[0], maxPoint[1]), maxPoint[2]);
 }
 
-
-
-/************************************************************
- * Normal calculations
- ************************************************************/
-void Mesh::computeVertexNormals () {
-    //initialisation des normales des vertex
-    for (unsigned int i = 0; i < vertices.size (); i++)
-        vertices[i].n = Vec3Df (0.0, 0.0, 0.0);
-
-    //Sum up neighboring normals
-    for (unsigned int i = 0; i < triangles.size (); i++) {
-        Vec3Df edge01 = vertices[triangles[i].v[1]].p -  vertices[triangles[i].v[0]].p;
-        Vec3Df edge02 = vertices[triangles[i].v[2]].p -  vertices[triangles[i].v[0]].p;
-        Vec3Df n = Vec3Df::crossProduct (edge01, edge02);
-        n.normalize ();
-        for (unsigned int j = 0; j < 3; j++)
-            vertices[triangles[i].v[j]].n += n;
+void Mesh::computeVertexNormals (NormalWeighting weighting) {
+    if (vertices.empty())
+        return;
+    if (weighting != NORMAL_WEIGHT_UNIFORM) {
+        std::vector<float> x(vertices.size()), y(vertices.size()), z(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            x[i] = vertices[i].p[0];
+            y[i] = vertices[i].p[1];
+            z[i] = vertices[i].p[2];
+        }
+        std::vector<float> nx(vertices.size()), ny(vertices.size()), nz(vertices.size());
+        soaComputeVertexNormals(&x[0], &y[0], &z[0], vertices.size(),
+            triangles.empty() ? 0 : reinterpret_cast<const uint32_t *>(triangles[0].v), triangles.size(), &nx[0], &ny[0], &nz[0],
+            weighting);
+        for (size_t i = 0; i < vertices.size(); i++)
+            vertices[i].n = Vec3Df(nx[i], ny[i], nz[i]);
+        return;
     }
 
-    //Normalize
-    for (unsigned int i = 0; i < vertices.size (); i++)
-        vertices[i].n.normalize ();
+    for (size_t i = 0; i < vertices.size(); i++)
+        vertices[i].n = Vec3Df(0.0, 0.0, 0.0);
+    //unit face normals summed at the corners, in triangle order
+    for (size_t i = 0; i < triangles.size(); i++) {
+        const unsigned int * v = triangles[i].v;
+        Vec3Df edge01 = vertices[v[1]].p - vertices[v[0]].p;
+        Vec3Df edge02 = vertices[v[2]].p - vertices[v[0]].p;
+        Vec3Df n = Vec3Df::crossProduct(edge01, edge02);
+        n.normalize();
+        for (int j = 0; j < 3; j++)
+            vertices[v[j]].n += n;
+    }
+    for (size_t i = 0; i < vertices.size(); i++)
+        vertices[i].n.normalize();
 }
 
-/************************************************************
- * Recenter and adjust the mesh - to ease computations
- ************************************************************/
 void Mesh::centerAndScaleToUnit () {
-    Vec3Df c;
-    for  (unsigned int i = 0; i < vertices.size (); i++)
-        c += vertices[i].p;
-    c /= vertices.size ();
-    float maxD = Vec3Df::distance (vertices[0].p, c);
-    for (unsigned int i = 0; i < vertices.size (); i++){
-        float m = Vec3Df::distance (vertices[i].p, c);
-        if (m > maxD)
-            maxD = m;
+    if (vertices.empty())
+        return;
+    //the mean is summed in double in vertex order, as soaCenterAndScaleToUnit does
+    double sum[3] = { 0.0, 0.0, 0.0 };
+    for (size_t i = 0; i < vertices.size(); i++) {
+        for (int j = 0; j < 3; j++)
+            sum[j] += vertices[i].p[j];
     }
-    for  (unsigned int i = 0; i < vertices.size (); i++)
+    size_t n = vertices.size();
+    Vec3Df c(float(sum[0] / n), float(sum[1] / n), float(sum[2] / n));
+    float maxSquared = 0.0f;
+    for (size_t i = 0; i < n; i++)
+        maxSquared = max(maxSquared, (vertices[i].p - c).getSquaredLength());
+    float maxD = sqrt(maxSquared);
+    if (maxD == 0.0f)
+        maxD = 1.0f; //a single point: only move it to the origin
+    for (size_t i = 0; i < n; i++)
         vertices[i].p = (vertices[i].p - c) / maxD;
 }
 
+void Mesh::centerNormalsAndBounds () {
+    centerAndScaleToUnit();
+    computeVertexNormals();
+    computeBoundingCube();
+}
+
 
 /************************************************************
  * Load
  ************************************************************/
 bool Mesh::loadMesh(const char * filename)
+{
+    ObjData obj;
+    if (!loadObj(filename, obj))
+        return false;
+
+    vertices.resize(obj.vertexCount());
+    parallelFor(0, vertices.size(), [&](size_t first, size_t last, unsigned int) {
+        for (size_t i = first; i < last; ++i)
+            vertices[i] = Vertex(Vec3Df(obj.positions[3 * i], obj.positions[3 * i + 1], obj.positions[3 * i + 2]));
+    });
+
+    //faces are triangulated as a fan around their first corner, like loadMeshLegacy does
+    std::vector<size_t> firstCorner(obj.faceCount() + 1, 0), firstTriangle(obj.faceCount() + 1, 0);
+    for (size_t f = 0; f < obj.faceCount(); ++f) {
+        unsigned int n = obj.faceSizes[f];
+        firstCorner[f + 1] = firstCorner[f] + n;
+        firstTriangle[f + 1] = firstTriangle[f] + (n >= 3 ? n - 2 : 0);
+        if (n < 3)
+            printf("TriMesh::LOAD: Unexpected number of face vertices (<3). Ignoring face");
+    }
+
+    triangles.resize(firstTriangle[obj.faceCount()]);
+    parallelFor(0, obj.faceCount(), [&](size_t first, size_t last, unsigned int) {
+        for (size_t f = first; f < last; ++f) {
+            const ObjIndex * corners = &obj.indices[firstCorner[f]];
+            size_t t = firstTriangle[f];
+            for (unsigned int i = 0; i + 2 < obj.faceSizes[f]; ++i)
+                triangles[t + i] = Triangle(corners[0].vertex, corners[i + 1].vertex, corners[i + 2].vertex);
+        }
+    });
+
+    centerNormalsAndBounds();
+    return true;
+}
+
+bool Mesh::loadMeshLegacy(const char * filename)
 { //do NOT try to understand this function... it is dirty...
 
     std::vector<int> vhandles;
@@ -207,9 +265,7 @@ bool Mesh::loadMesh(const char * filename)
     }
     fclose(in);
 
-    centerAndScaleToUnit ();
-    computeVertexNormals();
-	computeBoundingCube();
+    centerNormalsAndBounds();
     return true;
 }
 
@@ -0,0 +1,207 @@
+#include "meshcache.h"
+#include <stdio.h>
+
+namespace {
+
+const uint64_t FNV_OFFSET = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+//blobs start at multiples of this, so they can be used in place
+const size_t BLOB_ALIGNMENT = 16;
+
+inline size_t alignUp(size_t value)
+{
+	return (value + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT * BLOB_ALIGNMENT;
+}
+
+bool writeAll(FILE * f, const void * data, size_t size)
+{
+	return size == 0 || fwrite(data, 1, size, f) == size;
+}
+
+bool writePadding(FILE * f, size_t from, size_t to)
+{
+	static const char zeros[BLOB_ALIGNMENT] = {};
+	return writeAll(f, zeros, to - from);
+}
+
+//'count' elements of 'size' bytes from 'offset' fit in the file; divides instead of multiplying,
+//so header fields of a damaged file cannot wrap around
+bool blobFits(uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize)
+{
+	return offset <= fileSize && (count == 0 || (size != 0 && count <= (fileSize - offset) / size));
+}
+
+//every index names a vertex and every level lies in the index blob, the indices go to
+//glDrawElements as they are
+bool indicesInRange(const MeshCacheHeader & header, const char * data)
+{
+	const char * indices = data + header.indexOffset;
+	for (uint64_t i = 0; i < header.indexCount; i++)
+	{
+		uint32_t index;
+		if (header.indexSize == 2)
+		{
+			uint16_t narrow;
+			memcpy(&narrow, indices + i * 2, sizeof(narrow));
+			index = narrow;
+		}
+		else
+			memcpy(&index, indices + i * 4, sizeof(index));
+		if (index >= header.vertexCount)
+			return false;
+	}
+	const char * levels = data + header.levelOffset;
+	for (uint32_t i = 0; i < header.levelCount; i++)
+	{
+		LodLevel level;
+		memcpy(&level, levels + i * sizeof(LodLevel), sizeof(level));
+		if (uint64_t(level.firstIndex) + level.indexCount > header.indexCount)
+			return false;
+	}
+	return true;
+}
+
+} // namespace
+
+bool hashFiles(const std::vector<std::string> & filenames, uint64_t & hash)
+{
+	hash = FNV_OFFSET;
+	for (size_t i = 0; i < filenames.size(); i++)
+	{
+		MappedFile file;
+		if (!file.open(filenames[i].c_str()))
+			return false;
+		const unsigned char * p = reinterpret_cast<const unsigned char *>(file.data());
+		for (size_t j = 0; j < file.size(); j++)
+		{
+			hash ^= p[j];
+			hash *= FNV_PRIME;
+		}
+		//separate the files, so moving bytes from one file to the next changes the hash
+		hash ^= uint64_t(file.size());
+		hash *= FNV_PRIME;
+	}
+	return true;
+}
+
+uint64_t hashParameters(uint64_t hash, const void * data, size_t size)
+{
+	const unsigned char * p = reinterpret_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= p[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+bool writeMeshCache(const char * filename, uint64_t sourceHash, const VertexLayout & layout,
+	const void * vertices, size_t vertexCount, const uint32_t * indices, size_t indexCount,
+	const LodLevel * levels, size_t levelCount)
+{
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "FFMC", 4);
+	header.version = MESH_CACHE_VERSION;
+	header.sourceHash = sourceHash;
+	header.stride = layout.stride;
+	header.attributeCount = uint32_t(layout.attributes.size());
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	header.levelCount = uint32_t(levelCount);
+
+	//16 bit indices whenever all vertices can be addressed with them
+	bool shortIndices = vertexCount <= 0xffff;
+	header.indexSize = indexCount == 0 ? 0 : (shortIndices ? 2 : 4);
+
+	size_t layoutEnd = sizeof(header) + layout.attributes.size() * sizeof(VertexAttribute);
+	header.vertexOffset = alignUp(layoutEnd);
+	size_t vertexEnd = size_t(header.vertexOffset) + vertexCount * layout.stride;
+	header.indexOffset = alignUp(vertexEnd);
+	size_t indexEnd = size_t(header.indexOffset) + indexCount * header.indexSize;
+	header.levelOffset = alignUp(indexEnd);
+
+	std::string tmp = std::string(filename) + ".tmp";
+	FILE * f = fopen(tmp.c_str(), "wb");
+	if (!f)
+		return false;
+	bool ok = writeAll(f, &header, sizeof(header));
+	if (!layout.attributes.empty())
+		ok = ok && writeAll(f, &layout.attributes[0], layout.attributes.size() * sizeof(VertexAttribute));
+	ok = ok && writePadding(f, layoutEnd, size_t(header.vertexOffset));
+	ok = ok && writeAll(f, vertices, vertexCount * layout.stride);
+	ok = ok && writePadding(f, vertexEnd, size_t(header.indexOffset));
+	if (shortIndices)
+	{
+		std::vector<uint16_t> narrow(indices, indices + indexCount);
+		ok = ok && (narrow.empty() || writeAll(f, &narrow[0], narrow.size() * sizeof(uint16_t)));
+	}
+	else
+		ok = ok && writeAll(f, indices, indexCount * sizeof(uint32_t));
+	ok = ok && writePadding(f, indexEnd, size_t(header.levelOffset));
+	ok = ok && writeAll(f, levels, levelCount * sizeof(LodLevel));
+	ok = fclose(f) == 0 && ok;
+
+	if (ok)
+	{
+		remove(filename);
+		ok = rename(tmp.c_str(), filename) == 0;
+	}
+	if (!ok)
+		remove(tmp.c_str());
+	return ok;
+}
+
+bool MeshCache::open(const char * filename, uint64_t sourceHash, const VertexLayout & layout, bool checkHash)
+{
+	bool valid = open(filename)
+		&& (!checkHash || mHeader.sourceHash == sourceHash)
+		&& mLayout == layout;
+	if (!valid)
+		close();
+	return valid;
+}
+
+bool MeshCache::open(const char * filename)
+{
+	close();
+	if (!mFile.open(filename) || mFile.size() < sizeof(MeshCacheHeader))
+	{
+		close();
+		return false;
+	}
+	memcpy(&mHeader, mFile.data(), sizeof(mHeader));
+
+	bool valid = memcmp(mHeader.magic, "FFMC", 4) == 0
+		&& mHeader.version == MESH_CACHE_VERSION;
+	if (valid)
+	{
+		size_t layoutEnd = sizeof(MeshCacheHeader) + size_t(mHeader.attributeCount) * sizeof(VertexAttribute);
+		mLayout.stride = mHeader.stride;
+		if (layoutEnd > mFile.size())
+			valid = false;
+		else
+		{
+			mLayout.attributes.resize(mHeader.attributeCount);
+			if (!mLayout.attributes.empty())
+				memcpy(&mLayout.attributes[0], mFile.data() + sizeof(MeshCacheHeader), layoutEnd - sizeof(MeshCacheHeader));
+		}
+	}
+	//loadCachedMesh reads 2 byte indices or 4 byte ones, and a size only when there are indices
+	valid = valid && (mHeader.indexCount == 0 ? mHeader.indexSize == 0 : mHeader.indexSize == 2 || mHeader.indexSize == 4);
+	valid = valid && blobFits(mHeader.vertexOffset, mHeader.vertexCount, mHeader.stride, mFile.size())
+		&& blobFits(mHeader.indexOffset, mHeader.indexCount, mHeader.indexSize, mFile.size())
+		&& blobFits(mHeader.levelOffset, mHeader.levelCount, sizeof(LodLevel), mFile.size());
+	valid = valid && indicesInRange(mHeader, mFile.data());
+	if (!valid)
+		close();
+	return valid;
+}
+
+void MeshCache::close()
+{
+	mFile.close();
+	memset(&mHeader, 0, sizeof(mHeader));
+	mLayout = VertexLayout();
+}
@@ -0,0 +1,380 @@
+#include "meshdistance.h"
+#include "grid.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+const unsigned int SAH_BINS = 16;
+const uint32_t LEAF_TRIANGLES = 4;     //a range this small always becomes a leaf
+const uint32_t MAX_LEAF_TRIANGLES = 16; //larger ranges are split even when the SAH advises against it
+const int MAX_SAH_DEPTH = 48;          //deeper nodes are split at the median, which bounds the traversal stack
+const size_t PARALLEL_MIN_SAMPLES = 4096;
+
+struct Box
+{
+	Vec3Df min;
+	Vec3Df max;
+
+	Box() : min(FLT_MAX, FLT_MAX, FLT_MAX), max(-FLT_MAX, -FLT_MAX, -FLT_MAX) {}
+
+	void grow(const Vec3Df & p)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			min[k] = std::min(min[k], p[k]);
+			max[k] = std::max(max[k], p[k]);
+		}
+	}
+
+	void grow(const Box & b)
+	{
+		grow(b.min);
+		grow(b.max);
+	}
+
+	float area() const
+	{
+		if (min[0] > max[0])
+			return 0.0f;
+		Vec3Df d = max - min;
+		return 2.0f * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+	}
+};
+
+float pointSegmentDistance2(const Vec3Df & p, const Vec3Df & a, const Vec3Df & b)
+{
+	Vec3Df ab = b - a;
+	float length2 = ab.getSquaredLength();
+	float t = length2 > 0.0f ? std::min(1.0f, std::max(0.0f, Vec3Df::dotProduct(p - a, ab) / length2)) : 0.0f;
+	return (p - (a + ab * t)).getSquaredLength();
+}
+
+//closest point on the triangle by its Voronoi regions (Ericson, Real-Time Collision Detection 5.1.5)
+float pointTriangleDistance2(const Vec3Df & p, const Vec3Df & a, const Vec3Df & b, const Vec3Df & c)
+{
+	Vec3Df ab = b - a, ac = c - a, ap = p - a;
+	//the regions below divide by the squared edge lengths and area, a degenerate triangle is only its edges
+	if (!(Vec3Df::crossProduct(ab, ac).getSquaredLength() > 1e-12f * ab.getSquaredLength() * ac.getSquaredLength()))
+		return std::min(pointSegmentDistance2(p, a, b), std::min(pointSegmentDistance2(p, b, c), pointSegmentDistance2(p, c, a)));
+	float d1 = Vec3Df::dotProduct(ab, ap), d2 = Vec3Df::dotProduct(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+		return ap.getSquaredLength();
+	Vec3Df bp = p - b;
+	float d3 = Vec3Df::dotProduct(ab, bp), d4 = Vec3Df::dotProduct(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3)
+		return bp.getSquaredLength();
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		return (p - (a + ab * (d1 / (d1 - d3)))).getSquaredLength();
+	Vec3Df cp = p - c;
+	float d5 = Vec3Df::dotProduct(ab, cp), d6 = Vec3Df::dotProduct(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6)
+		return cp.getSquaredLength();
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		return (p - (a + ac * (d2 / (d2 - d6)))).getSquaredLength();
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		return (p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))))).getSquaredLength();
+	float denominator = 1.0f / (va + vb + vc);
+	return (p - (a + ab * (vb * denominator) + ac * (vc * denominator))).getSquaredLength();
+}
+
+template <typename Node>
+inline float boxDistance2(const Node & node, const Vec3Df & p)
+{
+	float d2 = 0.0f;
+	for (int k = 0; k < 3; k++)
+	{
+		float d = std::max(std::max(node.min[k] - p[k], p[k] - node.max[k]), 0.0f);
+		d2 += d * d;
+	}
+	return d2;
+}
+
+} // namespace
+
+/************************************************************
+ * Bounding volume hierarchy
+ ************************************************************/
+void TriangleBvh::build(const std::vector<Vertex> & vertices, const std::vector<Triangle> & triangles)
+{
+	mNodes.clear();
+	mCorners.clear();
+	if (triangles.empty())
+		return;
+
+	uint32_t count = uint32_t(triangles.size());
+	std::vector<uint32_t> order(count);
+	std::vector<Box> boxes(count);
+	std::vector<Vec3Df> centroids(count);
+	for (uint32_t t = 0; t < count; t++)
+	{
+		order[t] = t;
+		for (int j = 0; j < 3; j++)
+			boxes[t].grow(vertices[triangles[t].v[j]].p);
+		centroids[t] = (boxes[t].min + boxes[t].max) * 0.5f;
+	}
+
+	struct Range
+	{
+		uint32_t node, first, last;
+		int depth;
+	};
+	std::vector<Range> stack;
+	mNodes.reserve(2 * (count / LEAF_TRIANGLES + 1));
+	mNodes.push_back(Node());
+	Range root = { 0, 0, count, 0 };
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		Range range = stack.back();
+		stack.pop_back();
+		Box bounds, centroidBounds;
+		for (uint32_t i = range.first; i < range.last; i++)
+		{
+			bounds.grow(boxes[order[i]]);
+			centroidBounds.grow(centroids[order[i]]);
+		}
+		Node node;
+		for (int k = 0; k < 3; k++)
+		{
+			node.min[k] = bounds.min[k];
+			node.max[k] = bounds.max[k];
+		}
+		node.first = range.first;
+		node.count = range.last - range.first;
+
+		int axis = 0;
+		Vec3Df extent = centroidBounds.max - centroidBounds.min;
+		if (extent[1] > extent[axis])
+			axis = 1;
+		if (extent[2] > extent[axis])
+			axis = 2;
+		if (node.count <= LEAF_TRIANGLES || extent[axis] <= 0.0f)
+		{
+			mNodes[range.node] = node;
+			continue;
+		}
+
+		//binned surface area heuristic along the widest centroid axis
+		uint32_t mid = range.first;
+		if (range.depth < MAX_SAH_DEPTH)
+		{
+			Box binBoxes[SAH_BINS];
+			uint32_t binCounts[SAH_BINS] = {};
+			float scale = SAH_BINS / extent[axis];
+			for (uint32_t i = range.first; i < range.last; i++)
+			{
+				unsigned int bin = std::min(SAH_BINS - 1, unsigned((centroids[order[i]][axis] - centroidBounds.min[axis]) * scale));
+				binBoxes[bin].grow(boxes[order[i]]);
+				binCounts[bin]++;
+			}
+			float rightArea[SAH_BINS];
+			uint32_t rightCount[SAH_BINS];
+			Box right;
+			uint32_t rightSum = 0;
+			for (unsigned int b = SAH_BINS - 1; b > 0; b--)
+			{
+				right.grow(binBoxes[b]);
+				rightSum += binCounts[b];
+				rightArea[b] = right.area();
+				rightCount[b] = rightSum;
+			}
+			Box left;
+			uint32_t leftSum = 0;
+			float bestCost = FLT_MAX;
+			unsigned int bestSplit = 0;
+			for (unsigned int b = 1; b < SAH_BINS; b++)
+			{
+				left.grow(binBoxes[b - 1]);
+				leftSum += binCounts[b - 1];
+				if (leftSum == 0 || rightCount[b] == 0)
+					continue;
+				float cost = leftSum * left.area() + rightCount[b] * rightArea[b];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestSplit = b;
+				}
+			}
+			if (bestSplit > 0 && (bestCost < node.count * bounds.area() || node.count > MAX_LEAF_TRIANGLES))
+			{
+				mid = uint32_t(std::partition(order.begin() + range.first, order.begin() + range.last, [&](uint32_t t) {
+					return std::min(SAH_BINS - 1, unsigned((centroids[t][axis] - centroidBounds.min[axis]) * scale)) < bestSplit;
+				}) - order.begin());
+			}
+			else if (node.count <= MAX_LEAF_TRIANGLES)
+			{
+				mNodes[range.node] = node;
+				continue;
+			}
+		}
+		if (mid == range.first || mid == range.last)
+		{
+			mid = range.first + (range.last - range.first) / 2;
+			std::nth_element(order.begin() + range.first, order.begin() + mid, order.begin() + range.last,
+				[&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+		}
+
+		node.first = uint32_t(mNodes.size());
+		node.count = 0;
+		mNodes[range.node] = node;
+		mNodes.push_back(Node());
+		mNodes.push_back(Node());
+		Range leftRange = { node.first, range.first, mid, range.depth + 1 };
+		Range rightRange = { node.first + 1, mid, range.last, range.depth + 1 };
+		stack.push_back(rightRange);
+		stack.push_back(leftRange);
+	}
+
+	//the corners in leaf order, so a leaf reads one contiguous block
+	mCorners.resize(3 * size_t(count));
+	for (uint32_t i = 0; i < count; i++)
+	{
+		for (int j = 0; j < 3; j++)
+			mCorners[3 * size_t(i) + j] = vertices[triangles[order[i]].v[j]].p;
+	}
+}
+
+float TriangleBvh::triangleDistance2(const Vec3Df & p, uint32_t triangle) const
+{
+	const Vec3Df * c = &mCorners[3 * size_t(triangle)];
+	return pointTriangleDistance2(p, c[0], c[1], c[2]);
+}
+
+float TriangleBvh::closestDistance2(const Vec3Df & p, uint32_t & hint) const
+{
+	if (mNodes.empty())
+		return FLT_MAX;
+	float best = FLT_MAX;
+	if (hint < mCorners.size() / 3)
+		best = triangleDistance2(p, hint);
+
+	uint32_t stack[MAX_SAH_DEPTH + 40];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0)
+	{
+		const Node & node = mNodes[stack[--top]];
+		if (boxDistance2(node, p) >= best)
+			continue;
+		if (node.count > 0)
+		{
+			for (uint32_t t = node.first; t < node.first + node.count; t++)
+			{
+				float d2 = triangleDistance2(p, t);
+				if (d2 < best)
+				{
+					best = d2;
+					hint = t;
+				}
+			}
+			continue;
+		}
+		//nearer child on top of the stack
+		float left = boxDistance2(mNodes[node.first], p);
+		float right = boxDistance2(mNodes[node.first + 1], p);
+		if (left <= right)
+		{
+			if (right < best)
+				stack[top++] = node.first + 1;
+			stack[top++] = node.first;
+		}
+		else
+		{
+			if (left < best)
+				stack[top++] = node.first;
+			stack[top++] = node.first + 1;
+		}
+	}
+	return best;
+}
+
+/************************************************************
+ * Error measurement
+ ************************************************************/
+SurfaceDistance surfaceDistance(const Mesh & from, const TriangleBvh & to, unsigned int threads)
+{
+	SurfaceDistance distance = { 0.0, 0.0, 0 };
+	size_t vertexCount = from.vertices.size();
+	size_t sampleCount = vertexCount + from.triangles.size();
+	if (to.empty() || sampleCount == 0)
+		return distance;
+
+	//the vertices, then the triangle centroids
+	if (threads == 0)
+		threads = hardwareThreads();
+	std::vector<double> maxima(threads, 0.0), sums(threads, 0.0);
+	parallelFor(0, sampleCount, [&](size_t first, size_t last, unsigned int range) {
+		uint32_t hint = ~0u;
+		double maximum = 0.0, sum = 0.0;
+		for (size_t i = first; i < last; i++)
+		{
+			Vec3Df p;
+			if (i < vertexCount)
+				p = from.vertices[i].p;
+			else
+			{
+				const Triangle & t = from.triangles[i - vertexCount];
+				p = (from.vertices[t.v[0]].p + from.vertices[t.v[1]].p + from.vertices[t.v[2]].p) * (1.0f / 3.0f);
+			}
+			double d2 = to.closestDistance2(p, hint);
+			maximum = std::max(maximum, d2);
+			sum += d2;
+		}
+		maxima[range] = maximum;
+		sums[range] = sum;
+	}, threads, PARALLEL_MIN_SAMPLES);
+
+	double maximum = 0.0, sum = 0.0;
+	for (unsigned int t = 0; t < threads; t++)
+	{
+		maximum = std::max(maximum, maxima[t]);
+		sum += sums[t];
+	}
+	distance.max = std::sqrt(maximum);
+	distance.rms = std::sqrt(sum / double(sampleCount));
+	distance.samples = sampleCount;
+	return distance;
+}
+
+MeshError measureError(const Mesh & reference, const Mesh & simplified, unsigned int threads, const TriangleBvh * referenceBvh)
+{
+	TriangleBvh simplifiedBvh, ownReferenceBvh;
+	simplifiedBvh.build(simplified.vertices, simplified.triangles);
+	if (!referenceBvh)
+	{
+		ownReferenceBvh.build(reference.vertices, reference.triangles);
+		referenceBvh = &ownReferenceBvh;
+	}
+
+	MeshError error;
+	error.forward = surfaceDistance(reference, simplifiedBvh, threads);
+	error.backward = surfaceDistance(simplified, *referenceBvh, threads);
+	error.hausdorff = std::max(error.forward.max, error.backward.max);
+	size_t samples = error.forward.samples + error.backward.samples;
+	error.rms = samples == 0 ? 0.0 : std::sqrt((error.forward.rms * error.forward.rms * error.forward.samples
+		+ error.backward.rms * error.backward.rms * error.backward.samples) / double(samples));
+	return error;
+}
+
+unsigned int resolutionForError(const Mesh & mesh, double maxError, unsigned int maxResolution, unsigned int threads)
+{
+	TriangleBvh referenceBvh;
+	referenceBvh.build(mesh.vertices, mesh.triangles);
+	Grid grid;
+	unsigned int low = 1, high = std::max(1u, maxResolution);
+	while (low < high)
+	{
+		unsigned int r = low + (high - low) / 2;
+		if (measureError(mesh, grid.clusterMesh(mesh, r, threads), threads, &referenceBvh).hausdorff <= maxError)
+			high = r;
+		else
+			low = r + 1;
+	}
+	return low;
+}
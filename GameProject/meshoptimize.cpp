@@ -0,0 +1,388 @@
+#include "meshoptimize.h"
+#include "mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+
+namespace {
+
+const uint32_t UNUSED = 0xffffffffu;
+
+/************************************************************
+ * Forsyth scoring: vertices that are in the (LRU) cache and
+ * vertices with few remaining triangles score high
+ ************************************************************/
+const int FORSYTH_CACHE_SIZE = 32;
+const int FORSYTH_VALENCE_TABLE = 32;
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+struct ForsythTables
+{
+	float cache[FORSYTH_CACHE_SIZE];
+	float valence[FORSYTH_VALENCE_TABLE];
+	ForsythTables()
+	{
+		for (int i = 0; i < FORSYTH_CACHE_SIZE; i++)
+		{
+			if (i < 3)
+				cache[i] = LAST_TRIANGLE_SCORE;
+			else
+				cache[i] = powf(1.0f - float(i - 3) / (FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+		}
+		valence[0] = 0.0f;
+		for (int i = 1; i < FORSYTH_VALENCE_TABLE; i++)
+			valence[i] = VALENCE_BOOST_SCALE * powf(float(i), -VALENCE_BOOST_POWER);
+	}
+};
+
+float vertexScore(const ForsythTables & tables, int cachePosition, uint32_t liveTriangles)
+{
+	//vertices without triangles left never influence the choice
+	if (liveTriangles == 0)
+		return -1.0f;
+	float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+	if (liveTriangles < uint32_t(FORSYTH_VALENCE_TABLE))
+		return score + tables.valence[liveTriangles];
+	return score + VALENCE_BOOST_SCALE * powf(float(liveTriangles), -VALENCE_BOOST_POWER);
+}
+
+//FIFO cache simulation: a vertex is cached while fewer than cacheSize misses happened after its own
+struct FifoCache
+{
+	std::vector<uint32_t> timestamps;
+	uint32_t time;
+	unsigned int size;
+
+	FifoCache(size_t vertexCount, unsigned int cacheSize) : timestamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+	//returns 1 on a miss
+	unsigned int access(uint32_t vertex)
+	{
+		if (time - timestamps[vertex] > size)
+		{
+			timestamps[vertex] = time++;
+			return 1;
+		}
+		return 0;
+	}
+	void flush() { time += size + 1; }
+};
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const uint32_t * indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	FifoCache cache(vertexCount, cacheSize);
+	VertexCacheStats stats;
+	stats.transformed = 0;
+	for (size_t i = 0; i < indexCount; i++)
+		stats.transformed += cache.access(indices[i]);
+	stats.acmr = indexCount == 0 ? 0.0f : float(stats.transformed) / float(indexCount / 3);
+	stats.atvr = vertexCount == 0 ? 0.0f : float(stats.transformed) / float(vertexCount);
+	return stats;
+}
+
+void optimizeVertexCache(uint32_t * destination, const uint32_t * indices, size_t indexCount, size_t vertexCount)
+{
+	static const ForsythTables tables;
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	//triangles of every vertex, the first liveTriangles[v] entries are the ones not emitted yet
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; i++)
+		liveTriangles[indices[i]]++;
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + liveTriangles[v];
+	std::vector<uint32_t> adjacency(indexCount);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indexCount; i++)
+			adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vScore[v] = vertexScore(tables, -1, liveTriangles[v]);
+
+	std::vector<float> tScore(triangleCount);
+	std::vector<char> emitted(triangleCount, 0);
+	size_t best = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		tScore[t] = vScore[indices[3 * t]] + vScore[indices[3 * t + 1]] + vScore[indices[3 * t + 2]];
+		if (tScore[t] > tScore[best])
+			best = t;
+	}
+
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	int cacheCount = 0;
+	size_t cursor = 0; //next triangle in input order, used when the cache gives no candidate
+
+	for (size_t out = 0; out < triangleCount; out++)
+	{
+		if (best == size_t(UNUSED))
+		{
+			while (emitted[cursor])
+				cursor++;
+			best = cursor;
+		}
+		const uint32_t * triangle = indices + 3 * best;
+		destination[3 * out + 0] = triangle[0];
+		destination[3 * out + 1] = triangle[1];
+		destination[3 * out + 2] = triangle[2];
+		emitted[best] = 1;
+
+		//remove the triangle from the live lists of its vertices
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t v = triangle[k];
+			uint32_t * list = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < liveTriangles[v]; j++)
+			{
+				if (list[j] == best)
+				{
+					std::swap(list[j], list[liveTriangles[v] - 1]);
+					liveTriangles[v]--;
+					break;
+				}
+			}
+		}
+
+		//LRU update: the triangle's vertices move to the front
+		uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+		int newCount = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			if (std::find(newCache, newCache + newCount, triangle[k]) == newCache + newCount)
+				newCache[newCount++] = triangle[k];
+		}
+		for (int i = 0; i < cacheCount; i++)
+		{
+			if (std::find(newCache, newCache + newCount, cache[i]) == newCache + newCount)
+				newCache[newCount++] = cache[i];
+		}
+		for (int i = FORSYTH_CACHE_SIZE; i < newCount; i++)
+		{
+			cachePosition[newCache[i]] = -1;
+			vScore[newCache[i]] = vertexScore(tables, -1, liveTriangles[newCache[i]]);
+		}
+		for (int i = 0; i < newCount && i < FORSYTH_CACHE_SIZE; i++)
+		{
+			cachePosition[newCache[i]] = i;
+			vScore[newCache[i]] = vertexScore(tables, i, liveTriangles[newCache[i]]);
+		}
+
+		//rescore the triangles around the touched vertices, the best one touching the cache goes next
+		best = UNUSED;
+		float bestScore = -1.0f;
+		for (int i = 0; i < newCount; i++)
+		{
+			uint32_t v = newCache[i];
+			const uint32_t * list = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < liveTriangles[v]; j++)
+			{
+				uint32_t t = list[j];
+				tScore[t] = vScore[indices[3 * t]] + vScore[indices[3 * t + 1]] + vScore[indices[3 * t + 2]];
+				if (i < FORSYTH_CACHE_SIZE && tScore[t] > bestScore)
+				{
+					bestScore = tScore[t];
+					best = t;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+}
+
+void optimizeOverdraw(uint32_t * destination, const uint32_t * indices, size_t indexCount,
+	const float * positions, size_t vertexCount, size_t positionStride, float threshold)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	//hard boundaries: triangles that miss all their vertices start a new cluster anyway
+	std::vector<size_t> hard;
+	{
+		FifoCache cache(vertexCount, VERTEX_CACHE_SIZE);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			unsigned int misses = cache.access(indices[3 * t]) + cache.access(indices[3 * t + 1]) + cache.access(indices[3 * t + 2]);
+			if (t == 0 || misses == 3)
+				hard.push_back(t);
+		}
+		hard.push_back(triangleCount);
+	}
+
+	//soft boundaries: split a hard cluster as soon as the part so far is (almost) as cache friendly as the whole cluster
+	std::vector<size_t> clusters;
+	{
+		FifoCache cache(vertexCount, VERTEX_CACHE_SIZE);
+		for (size_t c = 0; c + 1 < hard.size(); c++)
+		{
+			size_t begin = hard[c], end = hard[c + 1];
+			cache.flush();
+			size_t clusterMisses = 0;
+			for (size_t t = begin; t < end; t++)
+				clusterMisses += cache.access(indices[3 * t]) + cache.access(indices[3 * t + 1]) + cache.access(indices[3 * t + 2]);
+			float limit = threshold * float(clusterMisses) / float(end - begin);
+
+			cache.flush();
+			size_t start = begin, misses = 0;
+			clusters.push_back(begin);
+			for (size_t t = begin; t < end; t++)
+			{
+				misses += cache.access(indices[3 * t]) + cache.access(indices[3 * t + 1]) + cache.access(indices[3 * t + 2]);
+				if (t + 1 < end && float(misses) / float(t + 1 - start) <= limit)
+				{
+					clusters.push_back(t + 1);
+					start = t + 1;
+					misses = 0;
+					cache.flush();
+				}
+			}
+		}
+		clusters.push_back(triangleCount);
+	}
+
+	//area weighted centroid and normal of each cluster and of the whole mesh
+	const char * base = reinterpret_cast<const char *>(positions);
+	size_t clusterCount = clusters.size() - 1;
+	std::vector<float> centroids(3 * clusterCount, 0.0f), normals(3 * clusterCount, 0.0f), areas(clusterCount, 0.0f);
+	float meshCentroid[3] = { 0, 0, 0 }, meshArea = 0;
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			const float * a = reinterpret_cast<const float *>(base + indices[3 * t] * positionStride);
+			const float * b = reinterpret_cast<const float *>(base + indices[3 * t + 1] * positionStride);
+			const float * d = reinterpret_cast<const float *>(base + indices[3 * t + 2] * positionStride);
+			float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (int k = 0; k < 3; k++)
+			{
+				float center = (a[k] + b[k] + d[k]) / 3.0f;
+				centroids[3 * c + k] += center * area;
+				meshCentroid[k] += center * area;
+				normals[3 * c + k] += n[k];
+			}
+			areas[c] += area;
+			meshArea += area;
+		}
+	}
+	for (int k = 0; k < 3; k++)
+		meshCentroid[k] = meshArea > 0 ? meshCentroid[k] / meshArea : 0.0f;
+
+	//clusters facing away from the center of the mesh are drawn first, they occlude the rest
+	std::vector<float> keys(clusterCount);
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float * n = &normals[3 * c];
+		float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		float key = 0.0f;
+		if (areas[c] > 0 && length > 0)
+		{
+			for (int k = 0; k < 3; k++)
+				key += (centroids[3 * c + k] / areas[c] - meshCentroid[k]) * n[k] / length;
+		}
+		keys[c] = key;
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+	size_t out = 0;
+	for (size_t i = 0; i < clusterCount; i++)
+	{
+		size_t c = order[i];
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++, out++)
+		{
+			destination[3 * out + 0] = indices[3 * t + 0];
+			destination[3 * out + 1] = indices[3 * t + 1];
+			destination[3 * out + 2] = indices[3 * t + 2];
+		}
+	}
+}
+
+size_t optimizeVertexFetchRemap(uint32_t * remap, uint32_t * indices, size_t indexCount, size_t vertexCount)
+{
+	std::fill(remap, remap + vertexCount, UNUSED);
+	uint32_t next = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint32_t & index = indices[i];
+		if (remap[index] == UNUSED)
+			remap[index] = next++;
+		index = remap[index];
+	}
+	return next;
+}
+
+size_t optimizeIndexedMesh(std::vector<uint32_t> & indices, std::vector<uint32_t> & remap,
+	const float * positions, size_t vertexCount, size_t positionStride, MeshOptimizeReport * report)
+{
+	if (report)
+		report->before = analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+	std::vector<uint32_t> ordered(indices.size());
+	optimizeVertexCache(ordered.data(), indices.data(), indices.size(), vertexCount);
+	if (positions)
+		optimizeOverdraw(indices.data(), ordered.data(), ordered.size(), positions, vertexCount, positionStride);
+	else
+		indices.swap(ordered);
+
+	remap.resize(vertexCount);
+	size_t used = optimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), vertexCount);
+
+	if (report)
+		report->after = analyzeVertexCache(indices.data(), indices.size(), used);
+	return used;
+}
+
+void optimizeMesh(Mesh & mesh, MeshOptimizeReport * report)
+{
+	std::vector<uint32_t> indices(3 * mesh.triangles.size());
+	for (size_t t = 0; t < mesh.triangles.size(); t++)
+	{
+		for (int k = 0; k < 3; k++)
+			indices[3 * t + k] = mesh.triangles[t].v[k];
+	}
+	std::vector<float> positions(3 * mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		for (int k = 0; k < 3; k++)
+			positions[3 * i + k] = mesh.vertices[i].p[k];
+	}
+
+	std::vector<uint32_t> remap;
+	size_t used = optimizeIndexedMesh(indices, remap, positions.data(), mesh.vertices.size(), 3 * sizeof(float), report);
+
+	std::vector<Vertex> vertices(used);
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		if (remap[i] != UNUSED)
+			vertices[remap[i]] = mesh.vertices[i];
+	}
+	mesh.vertices.swap(vertices);
+	for (size_t t = 0; t < mesh.triangles.size(); t++)
+		mesh.triangles[t] = Triangle(indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]);
+}
+
+std::ostream & operator<<(std::ostream & stream, const MeshOptimizeReport & report)
+{
+	stream << "ACMR " << report.before.acmr << " -> " << report.after.acmr
+		<< ", ATVR " << report.before.atvr << " -> " << report.after.atvr
+		<< ", " << report.before.transformed << " -> " << report.after.transformed << " vertex shader runs";
+	return stream;
+}
@@ -0,0 +1,612 @@
+#include "meshsoa.h"
+#include "mesh.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHSOA_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#define MESHSOA_AVX 1
+#include <immintrin.h>
+#endif
+
+SimdLevel bestSimdLevel()
+{
+#if defined(MESHSOA_AVX)
+	return SIMD_AVX;
+#elif defined(MESHSOA_SSE)
+	return SIMD_SSE;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+const char * simdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SIMD_AVX: return "AVX";
+	case SIMD_SSE: return "SSE";
+	default: return "scalar";
+	}
+}
+
+/************************************************************
+ * Vector operations, one struct per width. The kernels below are
+ * written once against this interface. Every operation rounds like
+ * its scalar counterpart (no reciprocal approximations, no fused
+ * multiply-add), which keeps the results equal to the Vec3Df code.
+ ************************************************************/
+
+struct ScalarOps
+{
+	typedef float V;
+	static const size_t W = 1;
+	static V zero() { return 0.0f; }
+	static V set1(float a) { return a; }
+	static V load(const float * p) { return *p; }
+	static void store(float * p, V a) { *p = a; }
+	static V add(V a, V b) { return a + b; }
+	static V sub(V a, V b) { return a - b; }
+	static V mul(V a, V b) { return a * b; }
+	static V div(V a, V b) { return a / b; }
+	static V sqrt(V a) { return (float)std::sqrt(a); }
+	static V min(V a, V b) { return a < b ? a : b; }
+	static V max(V a, V b) { return a > b ? a : b; }
+	//1 / length, or 1 for a zero length (Vec3D::normalize leaves these vectors unchanged)
+	static V rcpOrOne(V length) { return length == 0.0f ? 1.0f : 1.0f / length; }
+	//corner 'c' of W consecutive triangles
+	static V gather(const float * base, const uint32_t * t, int c) { return base[t[c]]; }
+	static float hmin(V a) { return a; }
+	static float hmax(V a) { return a; }
+	static float hsum(V a) { return a; }
+};
+
+#ifdef MESHSOA_SSE
+struct SseOps
+{
+	typedef __m128 V;
+	static const size_t W = 4;
+	static V zero() { return _mm_setzero_ps(); }
+	static V set1(float a) { return _mm_set1_ps(a); }
+	static V load(const float * p) { return _mm_loadu_ps(p); }
+	static void store(float * p, V a) { _mm_storeu_ps(p, a); }
+	static V add(V a, V b) { return _mm_add_ps(a, b); }
+	static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+	static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+	static V div(V a, V b) { return _mm_div_ps(a, b); }
+	static V sqrt(V a) { return _mm_sqrt_ps(a); }
+	static V min(V a, V b) { return _mm_min_ps(a, b); }
+	static V max(V a, V b) { return _mm_max_ps(a, b); }
+	static V rcpOrOne(V length)
+	{
+		V one = _mm_set1_ps(1.0f);
+		V isZero = _mm_cmpeq_ps(length, _mm_setzero_ps());
+		return _mm_or_ps(_mm_and_ps(isZero, one), _mm_andnot_ps(isZero, _mm_div_ps(one, length)));
+	}
+	static V gather(const float * base, const uint32_t * t, int c)
+	{
+		return _mm_set_ps(base[t[9 + c]], base[t[6 + c]], base[t[3 + c]], base[t[c]]);
+	}
+	static float hmin(V a)
+	{
+		a = _mm_min_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+		a = _mm_min_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtss_f32(a);
+	}
+	static float hmax(V a)
+	{
+		a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+		a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtss_f32(a);
+	}
+	static float hsum(V a)
+	{
+		a = _mm_add_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+		a = _mm_add_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtss_f32(a);
+	}
+};
+#endif
+
+#ifdef MESHSOA_AVX
+struct AvxOps
+{
+	typedef __m256 V;
+	static const size_t W = 8;
+	static V zero() { return _mm256_setzero_ps(); }
+	static V set1(float a) { return _mm256_set1_ps(a); }
+	static V load(const float * p) { return _mm256_loadu_ps(p); }
+	static void store(float * p, V a) { _mm256_storeu_ps(p, a); }
+	static V add(V a, V b) { return _mm256_add_ps(a, b); }
+	static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+	static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+	static V div(V a, V b) { return _mm256_div_ps(a, b); }
+	static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+	static V min(V a, V b) { return _mm256_min_ps(a, b); }
+	static V max(V a, V b) { return _mm256_max_ps(a, b); }
+	static V rcpOrOne(V length)
+	{
+		V one = _mm256_set1_ps(1.0f);
+		V isZero = _mm256_cmp_ps(length, _mm256_setzero_ps(), _CMP_EQ_OQ);
+		return _mm256_blendv_ps(_mm256_div_ps(one, length), one, isZero);
+	}
+	static V gather(const float * base, const uint32_t * t, int c)
+	{
+		return _mm256_set_ps(base[t[21 + c]], base[t[18 + c]], base[t[15 + c]], base[t[12 + c]],
+			base[t[9 + c]], base[t[6 + c]], base[t[3 + c]], base[t[c]]);
+	}
+	static float hmin(V a)
+	{
+		return SseOps::hmin(_mm_min_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)));
+	}
+	static float hmax(V a)
+	{
+		return SseOps::hmax(_mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)));
+	}
+	static float hsum(V a)
+	{
+		return SseOps::hsum(_mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)));
+	}
+};
+#endif
+
+/************************************************************
+ * Kernels
+ ************************************************************/
+
+template <typename Ops>
+static void bounds(const float * px, const float * py, const float * pz, size_t n, float minPoint[3], float maxPoint[3])
+{
+	typedef typename Ops::V V;
+	if (n == 0)
+	{
+		minPoint[0] = minPoint[1] = minPoint[2] = 0.0f;
+		maxPoint[0] = maxPoint[1] = maxPoint[2] = 0.0f;
+		return;
+	}
+	V minX = Ops::set1(px[0]), minY = Ops::set1(py[0]), minZ = Ops::set1(pz[0]);
+	V maxX = minX, maxY = minY, maxZ = minZ;
+	size_t i = 0;
+	for (; i + Ops::W <= n; i += Ops::W)
+	{
+		V x = Ops::load(px + i), y = Ops::load(py + i), z = Ops::load(pz + i);
+		minX = Ops::min(minX, x); maxX = Ops::max(maxX, x);
+		minY = Ops::min(minY, y); maxY = Ops::max(maxY, y);
+		minZ = Ops::min(minZ, z); maxZ = Ops::max(maxZ, z);
+	}
+	minPoint[0] = Ops::hmin(minX); maxPoint[0] = Ops::hmax(maxX);
+	minPoint[1] = Ops::hmin(minY); maxPoint[1] = Ops::hmax(maxY);
+	minPoint[2] = Ops::hmin(minZ); maxPoint[2] = Ops::hmax(maxZ);
+	for (; i < n; i++)
+	{
+		minPoint[0] = std::min(minPoint[0], px[i]); maxPoint[0] = std::max(maxPoint[0], px[i]);
+		minPoint[1] = std::min(minPoint[1], py[i]); maxPoint[1] = std::max(maxPoint[1], py[i]);
+		minPoint[2] = std::min(minPoint[2], pz[i]); maxPoint[2] = std::max(maxPoint[2], pz[i]);
+	}
+}
+
+template <typename Ops>
+static void centerAndScale(float * px, float * py, float * pz, size_t n)
+{
+	typedef typename Ops::V V;
+	if (n == 0)
+		return;
+
+	//the mean is summed in double, one vertex after the other like Mesh::centerAndScaleToUnit,
+	//so both (and every SIMD level) centre to the same bits
+	double sumX = 0.0, sumY = 0.0, sumZ = 0.0;
+	for (size_t i = 0; i < n; i++)
+	{
+		sumX += px[i]; sumY += py[i]; sumZ += pz[i];
+	}
+	float cx = (float)(sumX / n), cy = (float)(sumY / n), cz = (float)(sumZ / n);
+
+	//largest squared distance first, sqrt is monotonic
+	V centerX = Ops::set1(cx), centerY = Ops::set1(cy), centerZ = Ops::set1(cz);
+	V maxD2 = Ops::zero();
+	size_t i = 0;
+	for (; i + Ops::W <= n; i += Ops::W)
+	{
+		V dx = Ops::sub(Ops::load(px + i), centerX);
+		V dy = Ops::sub(Ops::load(py + i), centerY);
+		V dz = Ops::sub(Ops::load(pz + i), centerZ);
+		maxD2 = Ops::max(maxD2, Ops::add(Ops::add(Ops::mul(dx, dx), Ops::mul(dy, dy)), Ops::mul(dz, dz)));
+	}
+	float maxSquared = Ops::hmax(maxD2);
+	for (; i < n; i++)
+	{
+		float dx = px[i] - cx, dy = py[i] - cy, dz = pz[i] - cz;
+		maxSquared = std::max(maxSquared, dx * dx + dy * dy + dz * dz);
+	}
+	float maxD = (float)std::sqrt(maxSquared);
+	if (maxD == 0.0f)
+		maxD = 1.0f; //a single point: only move it to the origin
+
+	V scale = Ops::set1(maxD);
+	for (i = 0; i + Ops::W <= n; i += Ops::W)
+	{
+		Ops::store(px + i, Ops::div(Ops::sub(Ops::load(px + i), centerX), scale));
+		Ops::store(py + i, Ops::div(Ops::sub(Ops::load(py + i), centerY), scale));
+		Ops::store(pz + i, Ops::div(Ops::sub(Ops::load(pz + i), centerZ), scale));
+	}
+	for (; i < n; i++)
+	{
+		px[i] = (px[i] - cx) / maxD;
+		py[i] = (py[i] - cy) / maxD;
+		pz[i] = (pz[i] - cz) / maxD;
+	}
+}
+
+//normals of the triangles [first, last) into f[t - first], last - first a multiple of
+//Ops::W, unit length or (for area weighting) the plain cross product
+template <typename Ops, bool Normalize>
+static void faceNormals(const float * px, const float * py, const float * pz, const uint32_t * triangles,
+	size_t first, size_t last, float * fx, float * fy, float * fz)
+{
+	typedef typename Ops::V V;
+	for (size_t t = first; t < last; t += Ops::W)
+	{
+		const uint32_t * tri = triangles + 3 * t;
+		V x0 = Ops::gather(px, tri, 0), y0 = Ops::gather(py, tri, 0), z0 = Ops::gather(pz, tri, 0);
+		V e1x = Ops::sub(Ops::gather(px, tri, 1), x0);
+		V e1y = Ops::sub(Ops::gather(py, tri, 1), y0);
+		V e1z = Ops::sub(Ops::gather(pz, tri, 1), z0);
+		V e2x = Ops::sub(Ops::gather(px, tri, 2), x0);
+		V e2y = Ops::sub(Ops::gather(py, tri, 2), y0);
+		V e2z = Ops::sub(Ops::gather(pz, tri, 2), z0);
+
+		V nx = Ops::sub(Ops::mul(e1y, e2z), Ops::mul(e1z, e2y));
+		V ny = Ops::sub(Ops::mul(e1z, e2x), Ops::mul(e1x, e2z));
+		V nz = Ops::sub(Ops::mul(e1x, e2y), Ops::mul(e1y, e2x));
+		if (Normalize)
+		{
+			V length = Ops::sqrt(Ops::add(Ops::add(Ops::mul(nx, nx), Ops::mul(ny, ny)), Ops::mul(nz, nz)));
+			V scale = Ops::rcpOrOne(length);
+			nx = Ops::mul(nx, scale);
+			ny = Ops::mul(ny, scale);
+			nz = Ops::mul(nz, scale);
+		}
+		Ops::store(fx + (t - first), nx);
+		Ops::store(fy + (t - first), ny);
+		Ops::store(fz + (t - first), nz);
+	}
+}
+
+template <typename Ops, bool Normalize>
+static void faceNormalRange(const float * px, const float * py, const float * pz, const uint32_t * triangles,
+	size_t first, size_t last, float * fx, float * fy, float * fz)
+{
+	size_t vectorEnd = first + (last - first) / Ops::W * Ops::W;
+	size_t done = vectorEnd - first;
+	faceNormals<Ops, Normalize>(px, py, pz, triangles, first, vectorEnd, fx, fy, fz);
+	faceNormals<ScalarOps, Normalize>(px, py, pz, triangles, vectorEnd, last, fx + done, fy + done, fz + done);
+}
+
+template <typename Ops>
+static void normalizeArrays(float * nx, float * ny, float * nz, size_t first, size_t last)
+{
+	typedef typename Ops::V V;
+	for (size_t i = first; i < last; i += Ops::W)
+	{
+		V x = Ops::load(nx + i), y = Ops::load(ny + i), z = Ops::load(nz + i);
+		V scale = Ops::rcpOrOne(Ops::sqrt(Ops::add(Ops::add(Ops::mul(x, x), Ops::mul(y, y)), Ops::mul(z, z))));
+		Ops::store(nx + i, Ops::mul(x, scale));
+		Ops::store(ny + i, Ops::mul(y, scale));
+		Ops::store(nz + i, Ops::mul(z, scale));
+	}
+}
+
+//interior angle of the triangle at corner c
+static float cornerAngle(const float * px, const float * py, const float * pz, const uint32_t * triangles, size_t c)
+{
+	size_t t = c - c % 3;
+	uint32_t a = triangles[c], b = triangles[t + (c + 1) % 3], d = triangles[t + (c + 2) % 3];
+	Vec3Df e1(px[b] - px[a], py[b] - py[a], pz[b] - pz[a]);
+	Vec3Df e2(px[d] - px[a], py[d] - py[a], pz[d] - pz[a]);
+	float lengths = e1.getLength() * e2.getLength();
+	float cosine = lengths > 0.0f ? Vec3Df::dotProduct(e1, e2) / lengths : 1.0f;
+	return std::acos(std::max(-1.0f, std::min(1.0f, cosine)));
+}
+
+//What the triangles [first, last) add to the normals of their corners: the face normal,
+//written to x/y/z[t - first], or for angle weights the unit face normal times the corner
+//angle, written to x/y/z[c - 3 * first] (the arrays then hold 3 values per triangle).
+//Both normal paths below use this, so they add the very same values.
+template <typename Ops>
+static void cornerContributions(const float * px, const float * py, const float * pz, const uint32_t * triangles,
+	size_t first, size_t last, NormalWeighting weighting, float * x, float * y, float * z)
+{
+	if (weighting == NORMAL_WEIGHT_AREA)
+	{
+		faceNormalRange<Ops, false>(px, py, pz, triangles, first, last, x, y, z);
+		return;
+	}
+	faceNormalRange<Ops, true>(px, py, pz, triangles, first, last, x, y, z);
+	if (weighting != NORMAL_WEIGHT_ANGLE)
+		return;
+	//spread the face normals to the corners from the back, in place
+	for (size_t i = last - first; i-- > 0; )
+	{
+		float fx = x[i], fy = y[i], fz = z[i];
+		for (int j = 2; j >= 0; j--)
+		{
+			float angle = cornerAngle(px, py, pz, triangles, 3 * (first + i) + j);
+			x[3 * i + j] = fx * angle;
+			y[3 * i + j] = fy * angle;
+			z[3 * i + j] = fz * angle;
+		}
+	}
+}
+
+void VertexTriangleAdjacency::build(const uint32_t * triangles, size_t triangleCount, size_t vertexCount, unsigned int threads)
+{
+	//counting sort of the corners by vertex: count, prefix sum, then place the corners in
+	//order, so every list is sorted. Each thread owns a range of vertices and scans all the
+	//corners for them, which keeps the result independent of the thread count.
+	size_t cornerCount = 3 * triangleCount;
+	offsets.assign(vertexCount + 1, 0);
+	corners.resize(cornerCount);
+	std::vector<uint32_t> rangeTotals(std::max(1u, threads == 0 ? hardwareThreads() : threads) + 1, 0);
+	std::vector<size_t> rangeFirst(rangeTotals.size(), 0), rangeLast(rangeTotals.size(), 0);
+
+	unsigned int ranges = parallelFor(0, vertexCount, [&](size_t first, size_t last, unsigned int range) {
+		rangeFirst[range] = first;
+		rangeLast[range] = last;
+		for (size_t c = 0; c < cornerCount; c++)
+		{
+			uint32_t v = triangles[c];
+			if (v >= first && v < last)
+				offsets[v]++;
+		}
+		uint32_t sum = 0;
+		for (size_t v = first; v < last; v++)
+		{
+			uint32_t count = offsets[v];
+			offsets[v] = sum;
+			sum += count;
+		}
+		rangeTotals[range] = sum;
+	}, threads, 1 << 14);
+
+	std::vector<uint32_t> rangeStart(ranges, 0);
+	for (unsigned int r = 1; r < ranges; r++)
+		rangeStart[r] = rangeStart[r - 1] + rangeTotals[r - 1];
+
+	parallelFor(0, ranges, [&](size_t firstRange, size_t lastRange, unsigned int) {
+		for (size_t r = firstRange; r < lastRange; r++)
+		{
+			size_t first = rangeFirst[r], last = rangeLast[r];
+			for (size_t v = first; v < last; v++)
+				offsets[v] += rangeStart[r];
+			for (size_t c = 0; c < cornerCount; c++)
+			{
+				uint32_t v = triangles[c];
+				if (v >= first && v < last)
+					corners[offsets[v]++] = (uint32_t)c;
+			}
+		}
+	}, ranges, 1);
+
+	//offsets[v] now is the end of the list of v, that is the start of the next one
+	for (size_t v = vertexCount; v > 0; v--)
+		offsets[v] = offsets[v - 1];
+	offsets[0] = 0;
+}
+
+//below this the normals are summed on one thread
+const size_t PARALLEL_NORMALS_MIN_TRIANGLES = 1 << 14;
+
+template <typename Ops>
+static void vertexNormals(const float * px, const float * py, const float * pz, size_t n,
+	const uint32_t * triangles, size_t triangleCount, float * nx, float * ny, float * nz,
+	NormalWeighting weighting, unsigned int threads)
+{
+	//every vertex sums what its corners get, in index order, starting from 0: the same
+	//additions in the same order as the old loop, so any thread count gives the same bits
+	bool perCorner = weighting == NORMAL_WEIGHT_ANGLE;
+
+	unsigned int workers = threads == 0 ? hardwareThreads() : threads;
+	if (workers <= 1 || triangleCount < PARALLEL_NORMALS_MIN_TRIANGLES)
+	{
+		//one thread: a block of contributions at a time, scattered in index order into an
+		//interleaved x,y,z,0 accumulator, so the adds of a corner touch one cache line
+		const size_t blockSize = 256;
+		float bx[3 * blockSize], by[3 * blockSize], bz[3 * blockSize];
+		std::vector<float> sums(4 * n, 0.0f);
+		for (size_t first = 0; first < triangleCount; first += blockSize)
+		{
+			size_t last = std::min(first + blockSize, triangleCount);
+			cornerContributions<Ops>(px, py, pz, triangles, first, last, weighting, bx, by, bz);
+			for (size_t c = 3 * first; c < 3 * last; c++)
+			{
+				float * sum = &sums[4 * triangles[c]];
+				size_t k = perCorner ? c - 3 * first : (c - 3 * first) / 3;
+#ifdef MESHSOA_SSE
+				if (Ops::W > 1)
+				{
+					_mm_storeu_ps(sum, _mm_add_ps(_mm_loadu_ps(sum), _mm_set_ps(0.0f, bz[k], by[k], bx[k])));
+					continue;
+				}
+#endif
+				sum[0] += bx[k];
+				sum[1] += by[k];
+				sum[2] += bz[k];
+			}
+		}
+		size_t v = 0;
+#ifdef MESHSOA_SSE
+		for (; Ops::W > 1 && v + 4 <= n; v += 4)
+		{
+			__m128 x = _mm_loadu_ps(&sums[4 * v]), y = _mm_loadu_ps(&sums[4 * v + 4]);
+			__m128 z = _mm_loadu_ps(&sums[4 * v + 8]), w = _mm_loadu_ps(&sums[4 * v + 12]);
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_storeu_ps(nx + v, x);
+			_mm_storeu_ps(ny + v, y);
+			_mm_storeu_ps(nz + v, z);
+		}
+#endif
+		for (; v < n; v++)
+		{
+			nx[v] = sums[4 * v];
+			ny[v] = sums[4 * v + 1];
+			nz[v] = sums[4 * v + 2];
+		}
+		size_t vectorEnd = n - n % Ops::W;
+		normalizeArrays<Ops>(nx, ny, nz, 0, vectorEnd);
+		normalizeArrays<ScalarOps>(nx, ny, nz, vectorEnd, n);
+		return;
+	}
+
+	//several threads: all contributions first, then every vertex gathers its own through the
+	//vertex -> triangle adjacency, no two threads write the same vertex
+	std::vector<float> cx((perCorner ? 3 : 1) * triangleCount), cy(cx.size()), cz(cx.size());
+	parallelFor(0, triangleCount, [&](size_t first, size_t last, unsigned int) {
+		size_t offset = perCorner ? 3 * first : first;
+		cornerContributions<Ops>(px, py, pz, triangles, first, last, weighting, &cx[offset], &cy[offset], &cz[offset]);
+	}, threads, 4096);
+
+	VertexTriangleAdjacency adjacency;
+	adjacency.build(triangles, triangleCount, n, threads);
+	parallelFor(0, n, [&](size_t first, size_t last, unsigned int) {
+		for (size_t v = first; v < last; v++)
+		{
+			float x = 0.0f, y = 0.0f, z = 0.0f;
+			for (uint32_t i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; i++)
+			{
+				size_t k = perCorner ? adjacency.corners[i] : adjacency.corners[i] / 3;
+				x += cx[k];
+				y += cy[k];
+				z += cz[k];
+			}
+			nx[v] = x;
+			ny[v] = y;
+			nz[v] = z;
+		}
+		size_t vectorEnd = first + (last - first) / Ops::W * Ops::W;
+		normalizeArrays<Ops>(nx, ny, nz, first, vectorEnd);
+		normalizeArrays<ScalarOps>(nx, ny, nz, vectorEnd, last);
+	}, threads, 4096);
+}
+
+void soaComputeVertexNormals(const float * px, const float * py, const float * pz, size_t vertexCount,
+	const uint32_t * triangles, size_t triangleCount, float * nx, float * ny, float * nz,
+	NormalWeighting weighting, unsigned int threads, SimdLevel level)
+{
+#ifdef MESHSOA_AVX
+	if (level >= SIMD_AVX)
+		return vertexNormals<AvxOps>(px, py, pz, vertexCount, triangles, triangleCount, nx, ny, nz, weighting, threads);
+#endif
+#ifdef MESHSOA_SSE
+	if (level >= SIMD_SSE)
+		return vertexNormals<SseOps>(px, py, pz, vertexCount, triangles, triangleCount, nx, ny, nz, weighting, threads);
+#endif
+	vertexNormals<ScalarOps>(px, py, pz, vertexCount, triangles, triangleCount, nx, ny, nz, weighting, threads);
+}
+
+void soaCenterAndScaleToUnit(float * px, float * py, float * pz, size_t vertexCount, SimdLevel level)
+{
+#ifdef MESHSOA_AVX
+	if (level >= SIMD_AVX)
+		return centerAndScale<AvxOps>(px, py, pz, vertexCount);
+#endif
+#ifdef MESHSOA_SSE
+	if (level >= SIMD_SSE)
+		return centerAndScale<SseOps>(px, py, pz, vertexCount);
+#endif
+	centerAndScale<ScalarOps>(px, py, pz, vertexCount);
+}
+
+void soaBounds(const float * px, const float * py, const float * pz, size_t vertexCount,
+	float minPoint[3], float maxPoint[3], SimdLevel level)
+{
+#ifdef MESHSOA_AVX
+	if (level >= SIMD_AVX)
+		return bounds<AvxOps>(px, py, pz, vertexCount, minPoint, maxPoint);
+#endif
+#ifdef MESHSOA_SSE
+	if (level >= SIMD_SSE)
+		return bounds<SseOps>(px, py, pz, vertexCount, minPoint, maxPoint);
+#endif
+	bounds<ScalarOps>(px, py, pz, vertexCount, minPoint, maxPoint);
+}
+
+/************************************************************
+ * MeshSoA
+ ************************************************************/
+
+MeshSoA::MeshSoA() : bbEdgeSize(0.0f)
+{
+	bbOrigin[0] = bbOrigin[1] = bbOrigin[2] = 0.0f;
+}
+
+void MeshSoA::resize(size_t vertexCount)
+{
+	px.resize(vertexCount); py.resize(vertexCount); pz.resize(vertexCount);
+	nx.resize(vertexCount); ny.resize(vertexCount); nz.resize(vertexCount);
+}
+
+void MeshSoA::computeVertexNormals(NormalWeighting weighting, SimdLevel level)
+{
+	if (px.empty())
+		return;
+	soaComputeVertexNormals(&px[0], &py[0], &pz[0], px.size(),
+		triangles.empty() ? 0 : triangles[0].v, triangles.size(), &nx[0], &ny[0], &nz[0], weighting, 0, level);
+}
+
+void MeshSoA::centerAndScaleToUnit(SimdLevel level)
+{
+	if (px.empty())
+		return;
+	soaCenterAndScaleToUnit(&px[0], &py[0], &pz[0], px.size(), level);
+}
+
+void MeshSoA::computeBoundingCube(SimdLevel level)
+{
+	if (px.empty())
+		return;
+	float maxPoint[3];
+	soaBounds(&px[0], &py[0], &pz[0], px.size(), bbOrigin, maxPoint, level);
+	bbEdgeSize = std::max(std::max(maxPoint[0] - bbOrigin[0], maxPoint[1] - bbOrigin[1]), maxPoint[2] - bbOrigin[2]);
+}
+
+void MeshSoA::fromMesh(const Mesh & mesh)
+{
+	resize(mesh.vertices.size());
+	parallelFor(0, mesh.vertices.size(), [&](size_t first, size_t last, unsigned int) {
+		for (size_t i = first; i < last; i++)
+		{
+			const Vertex & v = mesh.vertices[i];
+			px[i] = v.p[0]; py[i] = v.p[1]; pz[i] = v.p[2];
+			nx[i] = v.n[0]; ny[i] = v.n[1]; nz[i] = v.n[2];
+		}
+	}, 0, 1 << 16);
+
+	triangles.resize(mesh.triangles.size());
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		for (int j = 0; j < 3; j++)
+			triangles[i].v[j] = mesh.triangles[i].v[j];
+	}
+	for (int j = 0; j < 3; j++)
+		bbOrigin[j] = mesh.bbOrigin[j];
+	bbEdgeSize = mesh.bbEdgeSize;
+}
+
+void MeshSoA::toMesh(Mesh & mesh) const
+{
+	mesh.vertices.resize(px.size());
+	parallelFor(0, px.size(), [&](size_t first, size_t last, unsigned int) {
+		for (size_t i = first; i < last; i++)
+			mesh.vertices[i] = Vertex(Vec3Df(px[i], py[i], pz[i]), Vec3Df(nx[i], ny[i], nz[i]));
+	}, 0, 1 << 16);
+
+	mesh.triangles.resize(triangles.size());
+	for (size_t i = 0; i < triangles.size(); i++)
+		mesh.triangles[i] = Triangle(triangles[i].v[0], triangles[i].v[1], triangles[i].v[2]);
+	mesh.bbOrigin = Vec3Df(bbOrigin[0], bbOrigin[1], bbOrigin[2]);
+	mesh.bbEdgeSize = bbEdgeSize;
+}
@@ -0,0 +1,109 @@
+#include "meshstream.h"
+#include "objparser.h"
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+MeshStream::MeshStream() : mChunkSize(0), mIsCache(false), mPositionOffset(0)
+{
+}
+
+bool MeshStream::open(const char * filename, size_t chunkSize)
+{
+	mFilename = filename;
+	mChunkSize = std::max<size_t>(chunkSize, 4096);
+	mIsCache = mCache.open(filename);
+	if (!mIsCache)
+	{
+		FILE * f = fopen(filename, "rb");
+		if (!f)
+			return false;
+		fclose(f);
+		return true;
+	}
+
+	const VertexLayout & layout = mCache.layout();
+	for (size_t i = 0; i < layout.attributes.size(); i++)
+	{
+		if (layout.attributes[i].semantic == SEMANTIC_POSITION && layout.attributes[i].components >= 3)
+		{
+			mPositionOffset = layout.attributes[i].offset;
+			return true;
+		}
+	}
+	mCache.close();
+	mIsCache = false;
+	return false;
+}
+
+bool MeshStream::readPositions(const std::function<bool(const float *, size_t)> & fn)
+{
+	if (!mIsCache)
+	{
+		return streamObj(mFilename.c_str(), mChunkSize, [&](const ObjData & obj) {
+			return obj.positions.empty() || fn(&obj.positions[0], obj.vertexCount());
+		});
+	}
+
+	//gather the positions out of the interleaved vertices
+	size_t stride = mCache.layout().stride;
+	size_t perPiece = std::max<size_t>(mChunkSize / stride, 1);
+	std::vector<float> xyz(3 * std::min(perPiece, mCache.vertexCount()));
+	const char * vertices = static_cast<const char *>(mCache.vertexData()) + mPositionOffset;
+	for (size_t first = 0; first < mCache.vertexCount(); first += perPiece)
+	{
+		size_t count = std::min(perPiece, mCache.vertexCount() - first);
+		for (size_t i = 0; i < count; i++)
+			memcpy(&xyz[3 * i], vertices + (first + i) * stride, 3 * sizeof(float));
+		if (!fn(&xyz[0], count))
+			return false;
+	}
+	return true;
+}
+
+bool MeshStream::readTriangles(const std::function<bool(const uint32_t *, size_t)> & fn)
+{
+	std::vector<uint32_t> triangles;
+	if (!mIsCache)
+	{
+		return streamObj(mFilename.c_str(), mChunkSize, [&](const ObjData & obj) {
+			triangles.clear();
+			const ObjIndex * corners = obj.indices.empty() ? 0 : &obj.indices[0];
+			for (size_t f = 0; f < obj.faceCount(); f++)
+			{
+				for (unsigned int i = 0; i + 2 < obj.faceSizes[f]; i++)
+				{
+					triangles.push_back(uint32_t(corners[0].vertex));
+					triangles.push_back(uint32_t(corners[i + 1].vertex));
+					triangles.push_back(uint32_t(corners[i + 2].vertex));
+				}
+				corners += obj.faceSizes[f];
+			}
+			return triangles.empty() || fn(&triangles[0], triangles.size() / 3);
+		});
+	}
+
+	//without indices every three vertices are a triangle
+	size_t indexCount = mCache.indexCount() != 0 ? mCache.indexCount() : mCache.vertexCount() / 3 * 3;
+	size_t perPiece = std::max<size_t>(mChunkSize / (3 * sizeof(uint32_t)), 1) * 3;
+	triangles.resize(std::min(perPiece, indexCount));
+	for (size_t first = 0; first + 3 <= indexCount; first += perPiece)
+	{
+		size_t count = std::min(perPiece, indexCount - first) / 3 * 3;
+		if (mCache.indexCount() == 0)
+		{
+			for (size_t i = 0; i < count; i++)
+				triangles[i] = uint32_t(first + i);
+		}
+		else if (mCache.indexSize() == 2)
+		{
+			const uint16_t * narrow = static_cast<const uint16_t *>(mCache.indexData()) + first;
+			std::copy(narrow, narrow + count, triangles.begin());
+		}
+		else
+			memcpy(&triangles[0], static_cast<const uint32_t *>(mCache.indexData()) + first, count * sizeof(uint32_t));
+		if (!fn(&triangles[0], count / 3))
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,154 @@
+#include "morphtargets.h"
+#include <cstddef>
+#include <sstream>
+#include <tiny_obj_loader.h>
+
+std::vector<std::string> MorphAsset::sources() const
+{
+	std::vector<std::string> files(1, baseFile);
+	for (size_t i = 0; i < targets.size(); i++)
+		files.push_back(targets[i].filename);
+	return files;
+}
+
+uint64_t MorphAsset::parameters() const
+{
+	if (lodResolutions.empty())
+		return 0;
+	uint64_t hash = hashParameters(0, &lodResolutions[0], lodResolutions.size() * sizeof(unsigned int));
+	return hashParameters(hash, &LOD_CLUSTERING_VERSION, sizeof(LOD_CLUSTERING_VERSION));
+}
+
+//grid resolutions of the simplified levels of the characters, fine to coarse
+static const unsigned int CHARACTER_LOD_RESOLUTIONS[] = { 48, 32, 20, 12 };
+
+#define MORPH_TARGET(file, type, pos, normal) { file, offsetof(type, pos), offsetof(type, normal) }
+
+MorphAsset aniviaAsset()
+{
+	MorphAsset asset;
+	asset.name = "anivia";
+	asset.cacheFile = "anivia.meshcache";
+	asset.baseFile = "anivia_start.obj";
+	//idle pose (animation between initial and idle pose), attack pose, dead pose
+	MorphTarget targets[] = {
+		MORPH_TARGET("anivia_open_wing.obj", AniviaVertex, pos_idle, normal_idle),
+		MORPH_TARGET("anivia_attack.obj", AniviaVertex, pos_attack, normal_attack),
+		MORPH_TARGET("anivia_dead.obj", AniviaVertex, pos_dead, normal_dead)
+	};
+	asset.targets.assign(targets, targets + 3);
+	asset.lodResolutions.assign(CHARACTER_LOD_RESOLUTIONS, CHARACTER_LOD_RESOLUTIONS + 4);
+	return asset;
+}
+
+MorphAsset enemyAsset()
+{
+	MorphAsset asset;
+	asset.name = "aatrox";
+	asset.cacheFile = "aatrox.meshcache";
+	asset.baseFile = "aatrox_low.obj";
+	MorphTarget targets[] = {
+		MORPH_TARGET("aatrox_high.obj", EnemyVertex, pos_idle, normal_idle),
+		MORPH_TARGET("aatrox_dead.obj", EnemyVertex, pos_dead, normal_dead)
+	};
+	asset.targets.assign(targets, targets + 2);
+	asset.lodResolutions.assign(CHARACTER_LOD_RESOLUTIONS, CHARACTER_LOD_RESOLUTIONS + 4);
+	return asset;
+}
+
+MorphAsset bossAsset()
+{
+	MorphAsset asset;
+	asset.name = "boss";
+	asset.cacheFile = "boss.meshcache";
+	asset.baseFile = "boss_low.obj";
+	MorphTarget targets[] = {
+		MORPH_TARGET("boss_high.obj", BossVertex, pos_idle, normal_idle),
+		MORPH_TARGET("boss_attack.obj", BossVertex, pos_attack, normal_attack)
+	};
+	asset.targets.assign(targets, targets + 2);
+	asset.lodResolutions.assign(CHARACTER_LOD_RESOLUTIONS, CHARACTER_LOD_RESOLUTIONS + 4);
+	return asset;
+}
+
+MorphAsset iceBergAsset()
+{
+	MorphAsset asset;
+	asset.name = "iceberg";
+	asset.cacheFile = "iceberg.meshcache";
+	asset.baseFile = "iceberg.obj";
+	return asset;
+}
+
+#undef MORPH_TARGET
+
+bool readMorphSource(const char * filename, MorphSource & source, std::string & error)
+{
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string err;
+	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename))
+	{
+		error = err;
+		return false;
+	}
+
+	source = MorphSource();
+	// Read triangle vertices from OBJ file
+	for (const auto& shape : shapes) {
+		source.shapeCornerCount.push_back(unsigned(shape.mesh.indices.size()));
+		for (const auto& index : shape.mesh.indices) {
+			// Retrieve coordinates for vertex by index
+			source.pos.push_back(glm::vec3(
+				attrib.vertices[3 * index.vertex_index + 0],
+				attrib.vertices[3 * index.vertex_index + 1],
+				attrib.vertices[3 * index.vertex_index + 2]));
+
+			// Retrieve components of normal by index
+			if (index.normal_index >= 0)
+				source.normal.push_back(glm::vec3(
+					attrib.normals[3 * index.normal_index + 0],
+					attrib.normals[3 * index.normal_index + 1],
+					attrib.normals[3 * index.normal_index + 2]));
+			else
+				source.normal.push_back(glm::vec3(0, 0, 0));
+
+			// Retrieve coordinates for texture
+			if (index.texcoord_index >= 0)
+				source.texCoor.push_back(glm::vec2(
+					attrib.texcoords[2 * index.texcoord_index + 0],
+					attrib.texcoords[2 * index.texcoord_index + 1]));
+			else
+				source.texCoor.push_back(glm::vec2(0, 0));
+
+			source.vertexIndex.push_back(index.vertex_index);
+		}
+	}
+	return true;
+}
+
+bool sameTopology(const MorphSource & base, const MorphSource & target, const char * targetName, std::string & error)
+{
+	std::ostringstream message;
+	message << targetName << ": ";
+	if (target.shapeCornerCount != base.shapeCornerCount)
+	{
+		message << "topology mismatch, " << target.shapeCornerCount.size() << " shapes with "
+			<< target.pos.size() << " triangle corners, expected " << base.shapeCornerCount.size()
+			<< " shapes with " << base.pos.size();
+		error = message.str();
+		return false;
+	}
+	for (size_t i = 0; i < base.vertexIndex.size(); i++)
+	{
+		if (base.vertexIndex[i] != target.vertexIndex[i])
+		{
+			message << "topology mismatch, triangle " << i / 3 << " uses vertex " << target.vertexIndex[i] + 1
+				<< " instead of " << base.vertexIndex[i] + 1;
+			error = message.str();
+			return false;
+		}
+	}
+	return true;
+}
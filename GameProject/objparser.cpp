@@ -0,0 +1,375 @@
+#include "objparser.h"
+#include "mappedfile.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+
+void ObjData::clear() {
+	positions.clear();
+	texcoords.clear();
+	normals.clear();
+	indices.clear();
+	faceSizes.clear();
+}
+
+namespace {
+
+//powers of ten that are exactly representable as float (5^10 < 2^24)
+const float exactPow10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool isBlank(char c) { return c == ' ' || c == '\t'; }
+inline bool isLineEnd(char c) { return c == '\n' || c == '\r'; }
+
+inline const char * skipBlanks(const char * p, const char * end) {
+	while (p < end && isBlank(*p))
+		++p;
+	return p;
+}
+
+inline const char * nextLine(const char * p, const char * end) {
+	const char * n = static_cast<const char *>(memchr(p, '\n', end - p));
+	return n ? n + 1 : end;
+}
+
+//slow path: let the C library convert the token
+const char * parseFloatLibc(const char * p, const char * end, float & value) {
+	const char * tokenEnd = p;
+	while (tokenEnd < end && !isBlank(*tokenEnd) && !isLineEnd(*tokenEnd) && *tokenEnd != '/')
+		++tokenEnd;
+	std::string token(p, tokenEnd);
+	char * stop = 0;
+	float v = strtof(token.c_str(), &stop);
+	if (stop == token.c_str())
+		return p;
+	value = v;
+	return p + (stop - token.c_str());
+}
+
+//A face corner index: 1-based, or negative when relative to the current end of the list.
+//Relative indices are turned into chunk-local 0-based indices and recorded,
+//so they can be shifted once the number of records in the preceding chunks is known.
+inline int resolveIndex(int raw, size_t count, size_t corner, std::vector<size_t> & relative) {
+	if (raw > 0)
+		return raw - 1;
+	if (raw < 0) {
+		relative.push_back(corner);
+		return int(count) + raw;
+	}
+	return -1;
+}
+
+struct ObjChunk {
+	ObjData data;
+	//corners whose vertex/texcoord/normal index is relative to the chunk start
+	std::vector<size_t> relative[3];
+};
+
+void parseChunk(const char * p, const char * end, ObjChunk & chunk) {
+	ObjData & obj = chunk.data;
+	while (p < end) {
+		p = skipBlanks(p, end);
+		if (p + 1 >= end)
+			break;
+
+		if (p[0] == 'v' && isBlank(p[1])) {
+			float xyz[3] = { 0.0f, 0.0f, 0.0f };
+			const char * q = p + 2;
+			for (int k = 0; k < 3; ++k)
+				q = parseObjFloat(skipBlanks(q, end), end, xyz[k]);
+			obj.positions.insert(obj.positions.end(), xyz, xyz + 3);
+		}
+		else if (p[0] == 'v' && p[1] == 't' && p + 2 < end && isBlank(p[2])) {
+			float uv[2] = { 0.0f, 0.0f };
+			const char * q = p + 3;
+			for (int k = 0; k < 2; ++k)
+				q = parseObjFloat(skipBlanks(q, end), end, uv[k]);
+			obj.texcoords.insert(obj.texcoords.end(), uv, uv + 2);
+		}
+		else if (p[0] == 'v' && p[1] == 'n' && p + 2 < end && isBlank(p[2])) {
+			float xyz[3] = { 0.0f, 0.0f, 0.0f };
+			const char * q = p + 3;
+			for (int k = 0; k < 3; ++k)
+				q = parseObjFloat(skipBlanks(q, end), end, xyz[k]);
+			obj.normals.insert(obj.normals.end(), xyz, xyz + 3);
+		}
+		else if (p[0] == 'f' && isBlank(p[1])) {
+			const char * q = p + 2;
+			unsigned int corners = 0;
+			for (;;) {
+				q = skipBlanks(q, end);
+				if (q >= end || isLineEnd(*q))
+					break;
+				ObjIndex index = { -1, -1, -1 };
+				int raw = 0;
+				const char * r = parseObjInt(q, end, raw);
+				if (r == q)
+					break;
+				size_t corner = obj.indices.size();
+				index.vertex = resolveIndex(raw, obj.positions.size() / 3, corner, chunk.relative[0]);
+				q = r;
+				if (q < end && *q == '/') {
+					++q;
+					r = parseObjInt(q, end, raw);
+					if (r != q)
+						index.texcoord = resolveIndex(raw, obj.texcoords.size() / 2, corner, chunk.relative[1]);
+					q = r;
+					if (q < end && *q == '/') {
+						++q;
+						r = parseObjInt(q, end, raw);
+						if (r != q)
+							index.normal = resolveIndex(raw, obj.normals.size() / 3, corner, chunk.relative[2]);
+						q = r;
+					}
+				}
+				//skip whatever is left of this corner
+				while (q < end && !isBlank(*q) && !isLineEnd(*q))
+					++q;
+				obj.indices.push_back(index);
+				++corners;
+			}
+			obj.faceSizes.push_back(corners);
+		}
+		p = nextLine(p, end);
+	}
+}
+
+} // namespace
+
+const char * parseObjInt(const char * p, const char * end, int & value) {
+	const char * s = p;
+	bool negative = false;
+	if (s < end && (*s == '-' || *s == '+')) {
+		negative = *s == '-';
+		++s;
+	}
+	if (s >= end || !isDigit(*s))
+		return p;
+	long long v = 0;
+	while (s < end && isDigit(*s)) {
+		if (v < 0x7fffffffLL)
+			v = v * 10 + (*s - '0');
+		++s;
+	}
+	value = int(negative ? -v : v);
+	return s;
+}
+
+const char * parseObjFloat(const char * p, const char * end, float & value) {
+	const char * s = p;
+	bool negative = false;
+	if (s < end && (*s == '-' || *s == '+')) {
+		negative = *s == '-';
+		++s;
+	}
+
+	unsigned long long mantissa = 0;
+	int significant = 0;
+	int exponent = 0;
+	bool anyDigit = false, truncated = false;
+
+	while (s < end && isDigit(*s)) {
+		anyDigit = true;
+		if (significant < 19) {
+			mantissa = mantissa * 10 + (*s - '0');
+			if (mantissa != 0)
+				++significant;
+		}
+		else {
+			++exponent;
+			truncated = true;
+		}
+		++s;
+	}
+	if (s < end && *s == '.') {
+		++s;
+		while (s < end && isDigit(*s)) {
+			anyDigit = true;
+			if (significant < 19) {
+				mantissa = mantissa * 10 + (*s - '0');
+				if (mantissa != 0)
+					++significant;
+				--exponent;
+			}
+			else
+				truncated = true;
+			++s;
+		}
+	}
+	if (!anyDigit)
+		return parseFloatLibc(p, end, value); //inf, nan, hex floats...
+
+	if (s < end && (*s == 'e' || *s == 'E')) {
+		const char * e = s + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '-' || *e == '+')) {
+			negativeExponent = *e == '-';
+			++e;
+		}
+		if (e < end && isDigit(*e)) {
+			int x = 0;
+			while (e < end && isDigit(*e)) {
+				if (x < 100000)
+					x = x * 10 + (*e - '0');
+				++e;
+			}
+			exponent += negativeExponent ? -x : x;
+			s = e;
+		}
+	}
+
+	//Exact fast path: mantissa and power of ten are both exact floats,
+	//so a single IEEE multiplication/division gives the correctly rounded result.
+	if (!truncated && mantissa <= (1ull << 24) && exponent >= -10 && exponent <= 10) {
+		float v = float(mantissa);
+		if (exponent < 0)
+			v /= exactPow10[-exponent];
+		else
+			v *= exactPow10[exponent];
+		value = negative ? -v : v;
+		return s;
+	}
+	return parseFloatLibc(p, end, value);
+}
+
+//'start' holds the number of v, vt and vn records before 'begin', relative indices are resolved against it
+static void parseObjText(const char * begin, const char * end, ObjData & obj, unsigned int threads, const size_t start[3]) {
+	obj.clear();
+	if (end <= begin)
+		return;
+	if (threads == 0)
+		threads = hardwareThreads();
+	//chunks smaller than this are not worth a thread
+	const size_t minChunkSize = 1 << 16;
+	size_t size = size_t(end - begin);
+	if (size / minChunkSize < threads)
+		threads = (unsigned int)(size / minChunkSize);
+	if (threads == 0)
+		threads = 1;
+
+	//newline aligned chunk boundaries
+	std::vector<const char *> bounds(threads + 1);
+	bounds[0] = begin;
+	for (unsigned int i = 1; i < threads; ++i) {
+		const char * b = begin + size * i / threads;
+		if (b < bounds[i - 1])
+			b = bounds[i - 1];
+		bounds[i] = b > begin && b[-1] == '\n' ? b : nextLine(b, end);
+	}
+	bounds[threads] = end;
+
+	std::vector<ObjChunk> chunks(threads);
+	parallelFor(0, threads, [&](size_t first, size_t last, unsigned int) {
+		for (size_t c = first; c < last; ++c)
+			parseChunk(bounds[c], bounds[c + 1], chunks[c]);
+	}, threads, 1);
+
+	if (threads == 1) {
+		std::swap(obj, chunks[0].data);
+		for (size_t i = 0; i < chunks[0].relative[0].size(); ++i)
+			obj.indices[chunks[0].relative[0][i]].vertex += int(start[0]);
+		for (size_t i = 0; i < chunks[0].relative[1].size(); ++i)
+			obj.indices[chunks[0].relative[1][i]].texcoord += int(start[1]);
+		for (size_t i = 0; i < chunks[0].relative[2].size(); ++i)
+			obj.indices[chunks[0].relative[2][i]].normal += int(start[2]);
+		return;
+	}
+
+	//offsets of every chunk in the merged arrays
+	std::vector<size_t> pos(threads + 1, 0), tex(threads + 1, 0), nor(threads + 1, 0), idx(threads + 1, 0), face(threads + 1, 0);
+	for (unsigned int c = 0; c < threads; ++c) {
+		const ObjData & d = chunks[c].data;
+		pos[c + 1] = pos[c] + d.positions.size();
+		tex[c + 1] = tex[c] + d.texcoords.size();
+		nor[c + 1] = nor[c] + d.normals.size();
+		idx[c + 1] = idx[c] + d.indices.size();
+		face[c + 1] = face[c] + d.faceSizes.size();
+	}
+	obj.positions.resize(pos[threads]);
+	obj.texcoords.resize(tex[threads]);
+	obj.normals.resize(nor[threads]);
+	obj.indices.resize(idx[threads]);
+	obj.faceSizes.resize(face[threads]);
+
+	parallelFor(0, threads, [&](size_t first, size_t last, unsigned int) {
+		for (size_t c = first; c < last; ++c) {
+			ObjChunk & chunk = chunks[c];
+			ObjData & d = chunk.data;
+			int base[3] = { int(start[0] + pos[c] / 3), int(start[1] + tex[c] / 2), int(start[2] + nor[c] / 3) };
+			for (size_t i = 0; i < chunk.relative[0].size(); ++i)
+				d.indices[chunk.relative[0][i]].vertex += base[0];
+			for (size_t i = 0; i < chunk.relative[1].size(); ++i)
+				d.indices[chunk.relative[1][i]].texcoord += base[1];
+			for (size_t i = 0; i < chunk.relative[2].size(); ++i)
+				d.indices[chunk.relative[2][i]].normal += base[2];
+
+			std::copy(d.positions.begin(), d.positions.end(), obj.positions.begin() + pos[c]);
+			std::copy(d.texcoords.begin(), d.texcoords.end(), obj.texcoords.begin() + tex[c]);
+			std::copy(d.normals.begin(), d.normals.end(), obj.normals.begin() + nor[c]);
+			std::copy(d.indices.begin(), d.indices.end(), obj.indices.begin() + idx[c]);
+			std::copy(d.faceSizes.begin(), d.faceSizes.end(), obj.faceSizes.begin() + face[c]);
+			d.clear();
+		}
+	}, threads, 1);
+}
+
+bool loadObj(const char * filename, ObjData & obj, unsigned int threads) {
+	MappedFile file;
+	if (!file.open(filename))
+		return false;
+	parseObj(file.data(), file.data() + file.size(), obj, threads);
+	return true;
+}
+
+void parseObj(const char * begin, const char * end, ObjData & obj, unsigned int threads) {
+	const size_t start[3] = { 0, 0, 0 };
+	parseObjText(begin, end, obj, threads, start);
+}
+
+bool streamObj(const char * filename, size_t chunkSize, const std::function<bool(const ObjData &)> & fn, unsigned int threads) {
+	FILE * f = fopen(filename, "rb");
+	if (!f)
+		return false;
+	std::vector<char> buffer(std::max<size_t>(chunkSize, 4096));
+	size_t filled = 0;
+	size_t start[3] = { 0, 0, 0 };
+	ObjData obj;
+	bool ok = true;
+	for (;;) {
+		filled += fread(&buffer[filled], 1, buffer.size() - filled, f);
+		bool atEnd = filled < buffer.size();
+		if (atEnd && ferror(f)) {
+			ok = false;
+			break;
+		}
+
+		//parse up to the last complete line, the rest moves to the front of the buffer
+		size_t used = filled;
+		if (!atEnd) {
+			while (used > 0 && buffer[used - 1] != '\n')
+				--used;
+			if (used == 0) {
+				//a single line longer than the buffer
+				buffer.resize(2 * buffer.size());
+				continue;
+			}
+		}
+		parseObjText(&buffer[0], &buffer[0] + used, obj, threads, start);
+		start[0] += obj.positions.size() / 3;
+		start[1] += obj.texcoords.size() / 2;
+		start[2] += obj.normals.size() / 3;
+		if (!fn(obj)) {
+			ok = false;
+			break;
+		}
+		std::copy(buffer.begin() + used, buffer.begin() + filled, buffer.begin());
+		filled -= used;
+		if (atEnd)
+			break;
+	}
+	fclose(f);
+	return ok;
+}
@@ -0,0 +1,396 @@
+#include "quadricsimplifier.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+const float BORDER_WEIGHT = 10.0f;     //border planes, relative to the squared length of the edge
+const float MIN_NORMAL_COSINE = 0.25f; //a collapse may turn the normal of a triangle by at most ~75 degrees
+const size_t ROUND_FRACTION = 4;       //a round looks at the cheapest 1/ROUND_FRACTION of the edges
+const unsigned int MAX_ROUNDS = 1000;
+
+//symmetric 4x4 matrix of the squared distance to a set of planes: a2 ab ac ad b2 bc bd c2 cd d2
+struct Quadric
+{
+	double q[10];
+
+	Quadric() { std::fill(q, q + 10, 0.0); }
+
+	void addPlane(const Vec3Df & n, const Vec3Df & p, double weight)
+	{
+		double a = n[0], b = n[1], c = n[2];
+		double d = -(a * p[0] + b * p[1] + c * p[2]);
+		double plane[4] = { a, b, c, d };
+		int k = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = i; j < 4; j++)
+				q[k++] += weight * plane[i] * plane[j];
+		}
+	}
+
+	Quadric & operator+=(const Quadric & other)
+	{
+		for (int k = 0; k < 10; k++)
+			q[k] += other.q[k];
+		return *this;
+	}
+
+	double error(const Vec3Df & v) const
+	{
+		double x = v[0], y = v[1], z = v[2];
+		double e = q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x
+			+ q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y
+			+ q[7] * z * z + 2.0 * q[8] * z + q[9];
+		return std::max(e, 0.0);
+	}
+
+	//point of least error, false if the quadric does not pin one down (flat or straight regions)
+	bool minimum(Vec3Df & v) const
+	{
+		double a00 = q[0], a01 = q[1], a02 = q[2], a11 = q[4], a12 = q[5], a22 = q[7];
+		double c0 = a11 * a22 - a12 * a12, c1 = a02 * a12 - a01 * a22, c2 = a01 * a12 - a02 * a11;
+		double det = a00 * c0 + a01 * c1 + a02 * c2;
+		double trace = a00 + a11 + a22;
+		if (!(std::fabs(det) > 1e-10 * trace * trace * trace))
+			return false;
+		double b0 = -q[3], b1 = -q[6], b2 = -q[8];
+		double inverse = 1.0 / det;
+		v = Vec3Df(float((c0 * b0 + c1 * b1 + c2 * b2) * inverse),
+			float((c1 * b0 + (a00 * a22 - a02 * a02) * b1 + (a02 * a01 - a00 * a12) * b2) * inverse),
+			float((c2 * b0 + (a01 * a02 - a00 * a12) * b1 + (a00 * a11 - a01 * a01) * b2) * inverse));
+		return true;
+	}
+};
+
+struct Edge
+{
+	uint32_t a, b;  //a < b, b collapses into a
+	uint8_t border; //used by a single triangle
+	uint8_t manifold;
+};
+
+inline bool hasCorner(const Triangle & t, uint32_t v)
+{
+	return t.v[0] == v || t.v[1] == v || t.v[2] == v;
+}
+
+//neighbours of 'v', sorted, each once per triangle it shares with v
+void neighbours(uint32_t v, const std::vector<Triangle> & mesh, const VertexTriangleAdjacency & adjacency, std::vector<uint32_t> & out)
+{
+	out.clear();
+	for (uint32_t i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; i++)
+	{
+		const Triangle & t = mesh[adjacency.corners[i] / 3];
+		for (int j = 0; j < 3; j++)
+		{
+			if (t.v[j] != v)
+				out.push_back(t.v[j]);
+		}
+	}
+	std::sort(out.begin(), out.end());
+}
+
+//false if moving corner 'from' of the triangles around it to 'to' turns one of them too far;
+//the triangles that also hold 'other' disappear with the collapse and are not checked
+bool keepsOrientation(uint32_t from, uint32_t other, const Vec3Df & to, const std::vector<Vec3Df> & positions,
+	const std::vector<Triangle> & mesh, const VertexTriangleAdjacency & adjacency)
+{
+	for (uint32_t i = adjacency.offsets[from]; i < adjacency.offsets[from + 1]; i++)
+	{
+		const Triangle & t = mesh[adjacency.corners[i] / 3];
+		if (hasCorner(t, other))
+			continue;
+		Vec3Df p[3], moved[3];
+		for (int j = 0; j < 3; j++)
+		{
+			p[j] = positions[t.v[j]];
+			moved[j] = t.v[j] == from ? to : p[j];
+		}
+		Vec3Df before = Vec3Df::crossProduct(p[1] - p[0], p[2] - p[0]);
+		Vec3Df after = Vec3Df::crossProduct(moved[1] - moved[0], moved[2] - moved[0]);
+		float limit = MIN_NORMAL_COSINE * std::sqrt(before.getSquaredLength() * after.getSquaredLength());
+		if (!(Vec3Df::dotProduct(before, after) > limit))
+			return false;
+	}
+	return true;
+}
+
+} // namespace
+
+Mesh QuadricSimplifier::simplifyMesh(const Mesh & mesh, size_t targetTriangles, unsigned int threads)
+{
+	Mesh simplified = collapseMesh(mesh, targetTriangles, threads);
+	simplified.centerNormalsAndBounds();
+	return simplified;
+}
+
+Mesh QuadricSimplifier::collapseMesh(const Mesh & mesh, size_t targetTriangles, unsigned int threads)
+{
+	rounds = 0;
+	collapses = 0;
+	size_t vertexCount = mesh.vertices.size();
+	std::vector<Vec3Df> positions(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		positions[v] = mesh.vertices[v].p;
+	std::vector<Triangle> triangles;
+	triangles.reserve(mesh.triangles.size());
+	for (size_t t = 0; t < mesh.triangles.size(); t++)
+	{
+		const Triangle & tri = mesh.triangles[t];
+		if (tri.v[0] != tri.v[1] && tri.v[1] != tri.v[2] && tri.v[0] != tri.v[2])
+			triangles.push_back(tri);
+	}
+
+	//planes of the triangles, weighted by their area
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t t = 0; t < triangles.size(); t++)
+	{
+		const Triangle & tri = triangles[t];
+		Vec3Df n = Vec3Df::crossProduct(positions[tri.v[1]] - positions[tri.v[0]], positions[tri.v[2]] - positions[tri.v[0]]);
+		float length = n.getLength();
+		if (length <= 0.0f)
+			continue;
+		for (int j = 0; j < 3; j++)
+			quadrics[tri.v[j]].addPlane(n / length, positions[tri.v[0]], 0.5 * length);
+	}
+
+	VertexTriangleAdjacency adjacency;
+	std::vector<uint8_t> dead;
+	std::vector<uint32_t> edgeStart(vertexCount + 1);
+	std::vector<uint8_t> border(vertexCount), locked(vertexCount);
+	std::vector<Edge> edges;
+	std::vector<float> costs;
+	std::vector<Vec3Df> targets;
+	std::vector<uint8_t> removes;
+	std::vector<uint32_t> order, selected;
+	while (triangles.size() > targetTriangles && rounds < MAX_ROUNDS)
+	{
+		adjacency.build(reinterpret_cast<const uint32_t *>(triangles[0].v), triangles.size(), vertexCount, threads);
+
+		//edges from the neighbours of every vertex: the count of a neighbour is the number of
+		//triangles on the edge; first counted, then written, both in parallel
+		for (int pass = 0; pass < 2; pass++)
+		{
+			parallelFor(0, vertexCount, [&](size_t first, size_t last, unsigned int) {
+				std::vector<uint32_t> around;
+				for (size_t v = first; v < last; v++)
+				{
+					neighbours(uint32_t(v), triangles, adjacency, around);
+					uint32_t count = 0, out = pass == 0 ? 0 : edgeStart[v];
+					bool onBorder = false;
+					for (size_t i = 0; i < around.size(); i += count)
+					{
+						count = 1;
+						while (i + count < around.size() && around[i + count] == around[i])
+							count++;
+						onBorder |= count == 1;
+						if (around[i] <= v)
+							continue;
+						if (pass == 1)
+						{
+							Edge edge = { uint32_t(v), around[i], uint8_t(count == 1), uint8_t(count <= 2) };
+							edges[out] = edge;
+						}
+						out++;
+					}
+					if (pass == 0)
+					{
+						edgeStart[v + 1] = out;
+						border[v] = onBorder;
+					}
+				}
+			}, threads);
+			if (pass == 0)
+			{
+				edgeStart[0] = 0;
+				for (size_t v = 0; v < vertexCount; v++)
+					edgeStart[v + 1] += edgeStart[v];
+				edges.resize(edgeStart[vertexCount]);
+			}
+		}
+
+		//open borders only move along themselves: a plane through the edge, perpendicular to its triangle
+		if (rounds == 0)
+		{
+			for (size_t e = 0; e < edges.size(); e++)
+			{
+				if (!edges[e].border)
+					continue;
+				uint32_t a = edges[e].a, b = edges[e].b;
+				for (uint32_t i = adjacency.offsets[a]; i < adjacency.offsets[a + 1]; i++)
+				{
+					const Triangle & tri = triangles[adjacency.corners[i] / 3];
+					if (!hasCorner(tri, b))
+						continue;
+					Vec3Df side = positions[b] - positions[a];
+					Vec3Df n = Vec3Df::crossProduct(positions[tri.v[1]] - positions[tri.v[0]], positions[tri.v[2]] - positions[tri.v[0]]);
+					Vec3Df normal = Vec3Df::crossProduct(side, n);
+					float length = normal.getLength();
+					if (length > 0.0f)
+					{
+						double weight = BORDER_WEIGHT * side.getSquaredLength();
+						quadrics[a].addPlane(normal / length, positions[a], weight);
+						quadrics[b].addPlane(normal / length, positions[a], weight);
+					}
+				}
+			}
+		}
+
+		//cost, position and validity of every collapse
+		costs.resize(edges.size());
+		targets.resize(edges.size());
+		removes.resize(edges.size());
+		parallelFor(0, edges.size(), [&](size_t first, size_t last, unsigned int) {
+			std::vector<uint32_t> aroundA, aroundB;
+			for (size_t e = first; e < last; e++)
+			{
+				const Edge & edge = edges[e];
+				uint32_t a = edge.a, b = edge.b;
+				costs[e] = FLT_MAX;
+				//an inner edge between two border vertices would pinch the surface
+				if (!edge.manifold || (!edge.border && border[a] && border[b]))
+					continue;
+
+				Quadric q = quadrics[a];
+				q += quadrics[b];
+				Vec3Df middle = (positions[a] + positions[b]) * 0.5f;
+				Vec3Df target;
+				if (!q.minimum(target) || (target - middle).getSquaredLength() > (positions[b] - positions[a]).getSquaredLength())
+				{
+					//no stable minimum near the edge: the best of its ends and middle
+					target = middle;
+					double best = q.error(middle);
+					if (q.error(positions[a]) <= best)
+					{
+						target = positions[a];
+						best = q.error(positions[a]);
+					}
+					if (q.error(positions[b]) < best)
+						target = positions[b];
+				}
+
+				//link condition: the common neighbours of a and b are exactly the third corners
+				//of the triangles on the edge
+				neighbours(a, triangles, adjacency, aroundA);
+				neighbours(b, triangles, adjacency, aroundB);
+				aroundA.erase(std::unique(aroundA.begin(), aroundA.end()), aroundA.end());
+				aroundB.erase(std::unique(aroundB.begin(), aroundB.end()), aroundB.end());
+				size_t common = 0;
+				for (size_t i = 0, j = 0; i < aroundA.size() && j < aroundB.size();)
+				{
+					if (aroundA[i] < aroundB[j])
+						i++;
+					else if (aroundB[j] < aroundA[i])
+						j++;
+					else
+					{
+						common++;
+						i++;
+						j++;
+					}
+				}
+				uint8_t shared = edge.border ? 1 : 2;
+				if (common != shared)
+					continue;
+				if (!keepsOrientation(a, b, target, positions, triangles, adjacency) ||
+					!keepsOrientation(b, a, target, positions, triangles, adjacency))
+					continue;
+
+				costs[e] = float(q.error(target));
+				targets[e] = target;
+				removes[e] = shared;
+			}
+		}, threads);
+
+		//cheapest collapses first, ties by edge so the order is the same for any thread count
+		order.clear();
+		for (size_t e = 0; e < edges.size(); e++)
+		{
+			if (costs[e] < FLT_MAX)
+				order.push_back(uint32_t(e));
+		}
+		if (order.empty())
+			break;
+		auto cheaper = [&costs](uint32_t x, uint32_t y) { return costs[x] < costs[y] || (costs[x] == costs[y] && x < y); };
+		size_t considered = std::min(order.size(), edges.size() / ROUND_FRACTION + 1);
+		std::nth_element(order.begin(), order.begin() + (considered - 1), order.end(), cheaper);
+		std::sort(order.begin(), order.begin() + considered, cheaper);
+
+		//independent set: once a collapse is taken, every corner of its triangles is locked, so
+		//no two collapses of a round touch the same triangle or move a vertex the other reads
+		std::fill(locked.begin(), locked.end(), 0);
+		selected.clear();
+		size_t removed = 0;
+		for (size_t i = 0; i < considered && triangles.size() - removed > targetTriangles; i++)
+		{
+			const Edge & edge = edges[order[i]];
+			if (locked[edge.a] || locked[edge.b])
+				continue;
+			uint32_t ends[2] = { edge.a, edge.b };
+			for (int k = 0; k < 2; k++)
+			{
+				for (uint32_t j = adjacency.offsets[ends[k]]; j < adjacency.offsets[ends[k] + 1]; j++)
+				{
+					const Triangle & tri = triangles[adjacency.corners[j] / 3];
+					locked[tri.v[0]] = locked[tri.v[1]] = locked[tri.v[2]] = 1;
+				}
+			}
+			selected.push_back(order[i]);
+			removed += removes[order[i]];
+		}
+
+		dead.assign(triangles.size(), 0);
+		parallelFor(0, selected.size(), [&](size_t first, size_t last, unsigned int) {
+			for (size_t s = first; s < last; s++)
+			{
+				size_t e = selected[s];
+				uint32_t a = edges[e].a, b = edges[e].b;
+				positions[a] = targets[e];
+				quadrics[a] += quadrics[b];
+				for (uint32_t j = adjacency.offsets[b]; j < adjacency.offsets[b + 1]; j++)
+				{
+					uint32_t t = adjacency.corners[j] / 3;
+					Triangle & tri = triangles[t];
+					if (hasCorner(tri, a))
+						dead[t] = 1;
+					else
+						tri.v[tri.v[0] == b ? 0 : tri.v[1] == b ? 1 : 2] = a;
+				}
+			}
+		}, threads, 256);
+		size_t kept = 0;
+		for (size_t t = 0; t < triangles.size(); t++)
+		{
+			if (!dead[t])
+				triangles[kept++] = triangles[t];
+		}
+		triangles.resize(kept);
+		collapses += selected.size();
+		rounds++;
+	}
+
+	//the vertices the triangles still use, in their original order
+	std::vector<uint32_t> remap(vertexCount, ~0u);
+	for (size_t t = 0; t < triangles.size(); t++)
+	{
+		for (int j = 0; j < 3; j++)
+			remap[triangles[t].v[j]] = 0;
+	}
+	std::vector<Vertex> vertices;
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] == ~0u)
+			continue;
+		remap[v] = uint32_t(vertices.size());
+		vertices.push_back(Vertex(positions[v], Vec3Df()));
+	}
+	for (size_t t = 0; t < triangles.size(); t++)
+	{
+		for (int j = 0; j < 3; j++)
+			triangles[t].v[j] = remap[triangles[t].v[j]];
+	}
+	return Mesh(vertices, triangles);
+}
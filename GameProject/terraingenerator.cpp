@@ -0,0 +1,208 @@
+#include "terraingenerator.h"
+#include "terrainshadow.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <glm/gtx/normal.hpp>
+
+namespace {
+
+const int NOISE_OCTAVES = 4;
+const float NOISE_FREQUENCY = 1.0f / 16.0f; //of the first octave, per vertex
+const float DETAIL = 0.25f;                 //share of the random detail in the heights
+//lights so low that the shadows reach further only get the shadows of this many rows
+const int MAX_SHADOW_ROWS = 256;
+
+uint32_t hash(uint32_t seed, int x, int z)
+{
+	uint32_t h = seed * 0x9E3779B9u ^ uint32_t(x) * 0x85EBCA6Bu ^ uint32_t(z) * 0xC2B2AE35u;
+	h ^= h >> 16;
+	h *= 0x7FEB352Du;
+	h ^= h >> 15;
+	h *= 0x846CA68Bu;
+	h ^= h >> 16;
+	return h;
+}
+
+//gradient of lattice point (x, z) dotted with the offset (dx, dz) from it
+float gradient(uint32_t seed, int x, int z, float dx, float dz)
+{
+	static const float directions[8][2] = {
+		{ 1.0f, 0.0f }, { -1.0f, 0.0f }, { 0.0f, 1.0f }, { 0.0f, -1.0f },
+		{ 0.7071f, 0.7071f }, { -0.7071f, 0.7071f }, { 0.7071f, -0.7071f }, { -0.7071f, -0.7071f }
+	};
+	const float * g = directions[hash(seed, x, z) & 7];
+	return g[0] * dx + g[1] * dz;
+}
+
+float fade(float t)
+{
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+//gradient noise, about -0.7..0.7
+float gradientNoise(uint32_t seed, float x, float z)
+{
+	float fx = std::floor(x), fz = std::floor(z);
+	int x0 = int(fx), z0 = int(fz);
+	float dx = x - fx, dz = z - fz;
+	float u = fade(dx), v = fade(dz);
+	float n00 = gradient(seed, x0, z0, dx, dz);
+	float n10 = gradient(seed, x0 + 1, z0, dx - 1.0f, dz);
+	float n01 = gradient(seed, x0, z0 + 1, dx, dz - 1.0f);
+	float n11 = gradient(seed, x0 + 1, z0 + 1, dx - 1.0f, dz - 1.0f);
+	float near = n00 + u * (n10 - n00);
+	float far = n01 + u * (n11 - n01);
+	return near + v * (far - near);
+}
+
+} // namespace
+
+void terrainRowHeights(uint32_t seed, int row, int columns, float * heights)
+{
+	//the detail of every row has its own generator, so any row can be made alone
+	std::minstd_rand random(hash(seed, -1, row));
+	std::uniform_real_distribution<float> detail(0.0f, 1.0f);
+	for (int column = 0; column < columns; column++)
+	{
+		float noise = 0.0f, amplitude = 1.0f, amplitudes = 0.0f, frequency = NOISE_FREQUENCY;
+		for (int octave = 0; octave < NOISE_OCTAVES; octave++)
+		{
+			noise += amplitude * gradientNoise(seed + octave, column * frequency, row * frequency);
+			amplitudes += amplitude;
+			amplitude *= 0.5f;
+			frequency *= 2.0f;
+		}
+		float height = 0.5f + 0.5f * noise / (0.7f * amplitudes);
+		height = (1.0f - DETAIL) * height + DETAIL * detail(random);
+		heights[column] = std::min(std::max(height, 0.0f), 1.0f);
+	}
+}
+
+void generateTerrainChunk(const TerrainSettings & settings, int chunkIndex, TerrainChunk & chunk)
+{
+	int columns = settings.columns;
+	int first = chunkIndex * settings.chunkRows, end = first + settings.chunkRows;
+
+	//the chunk with the rows its shadows and normals depend on (the terrain starts at row 0)
+	int margin = std::max(terrainShadowReach(settings.lightDir, 1.0f, MAX_SHADOW_ROWS), 1);
+	int windowFirst = std::max(first - margin, 0);
+	int windowRows = end + margin - windowFirst;
+	std::vector<float> heights(size_t(windowRows) * columns);
+	for (int i = 0; i < windowRows; i++)
+		terrainRowHeights(settings.seed, windowFirst + i, columns, &heights[size_t(i) * columns]);
+	std::vector<uint8_t> shadowed;
+	terrainShadows(&heights[0], columns, windowRows, settings.lightDir, shadowed, false);
+
+	auto position = [&](int row, int column) {
+		return glm::vec3(column, heights[size_t(row - windowFirst) * columns + column], row);
+	};
+	chunk.firstRow = first;
+	chunk.vertices.resize(size_t(settings.chunkRows) * columns);
+	for (int i = first; i < end; i++)
+	{
+		terrainVertex * row = &chunk.vertices[size_t(i - first) * columns];
+		for (int j = 0; j < columns; j++)
+		{
+			row[j].pos = position(i, j);
+			row[j].normal = { 0,0,0 };
+			row[j].texCoor = { j / float(columns), 0.0f };
+			float shade = shadowed[size_t(i - windowFirst) * columns + j] ? 0.5f : 1.0f;
+			row[j].shadow = { shade, shade, shade };
+		}
+
+		// normals from the triangles of the strips above and below the row
+		for (int strip = std::max(i - 1, 0); strip <= i; strip++)
+		{
+			for (int j = 0; j < columns - 1; j++)
+			{
+				glm::vec3 normal_1, normal_2;
+				normal_1 = glm::triangleNormal(position(strip, j), position(strip, j + 1), position(strip + 1, j + 1));
+				normal_2 = glm::triangleNormal(position(strip + 1, j + 1), position(strip + 1, j), position(strip, j));
+				if (strip == i)
+				{
+					row[j].normal += normal_1 + normal_2;
+					row[j + 1].normal += normal_1;
+				}
+				else
+				{
+					row[j].normal += normal_2;
+					row[j + 1].normal += normal_1 + normal_2;
+				}
+			}
+		}
+		for (int j = 0; j < columns; j++)
+			row[j].normal = glm::normalize(row[j].normal);
+	}
+}
+
+TerrainGenerator::TerrainGenerator(const TerrainSettings & settings, int prefetchChunks)
+	: mSettings(settings), mReady(prefetchChunks + 1), mSpent(prefetchChunks + 1), mCurrent(nullptr),
+	mCurrentRow(0), mStop(false)
+{
+	//the prefetched chunks and the one the main thread reads
+	for (int i = 0; i <= prefetchChunks; i++)
+	{
+		mChunks.push_back(std::unique_ptr<TerrainChunk>(new TerrainChunk()));
+		mSpent.push(mChunks.back().get());
+	}
+	mWorker = std::thread(&TerrainGenerator::workerLoop, this);
+}
+
+TerrainGenerator::~TerrainGenerator()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop.store(true);
+	}
+	mChunkSpent.notify_one();
+	mWorker.join();
+}
+
+void TerrainGenerator::workerLoop()
+{
+	int chunkIndex = 0;
+	while (!mStop.load())
+	{
+		TerrainChunk * chunk;
+		if (!mSpent.pop(chunk))
+		{
+			//all the chunks are made ahead: sleep until the scrolling uses one
+			std::unique_lock<std::mutex> lock(mMutex);
+			mChunkSpent.wait(lock, [&] { return mStop.load() || mSpent.pop(chunk); });
+			if (mStop.load())
+				return;
+		}
+		generateTerrainChunk(mSettings, chunkIndex++, *chunk);
+		{
+			//under the lock, so nextRow() cannot miss the chunk between its check and its wait;
+			//there are as many places as chunks
+			std::lock_guard<std::mutex> lock(mMutex);
+			mReady.push(chunk);
+		}
+		mChunkReady.notify_one();
+	}
+}
+
+const terrainVertex * TerrainGenerator::nextRow()
+{
+	if (mCurrent && mCurrentRow == mSettings.chunkRows)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mSpent.push(mCurrent);
+		}
+		mChunkSpent.notify_one();
+		mCurrent = nullptr;
+	}
+	if (!mCurrent)
+	{
+		if (!mReady.pop(mCurrent))
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mChunkReady.wait(lock, [this] { return mReady.pop(mCurrent); });
+		}
+		mCurrentRow = 0;
+	}
+	return &mCurrent->vertices[size_t(mCurrentRow++) * mSettings.columns];
+}
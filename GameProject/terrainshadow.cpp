@@ -0,0 +1,289 @@
+#include "terrainshadow.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <glm/gtx/intersect.hpp>
+
+namespace {
+
+//The heightfield seen along the sweep: 'major' is the axis the lines advance on one vertex at a
+//time, 'minor' the other one. Rows (z) repeat if 'rowsRepeat', columns (x) end at the border.
+struct SweepGrid
+{
+	const float * heights;
+	int columns, rows;
+	bool majorIsRow;
+	bool rowsRepeat;
+
+	int majorCount() const { return majorIsRow ? rows : columns; }
+	int minorCount() const { return majorIsRow ? columns : rows; }
+	bool majorRepeats() const { return majorIsRow && rowsRepeat; }
+	bool minorRepeats() const { return !majorIsRow && rowsRepeat; }
+
+	float height(int row, int column) const
+	{
+		return heights[size_t(row) * columns + column];
+	}
+
+	float at(int major, int minor) const
+	{
+		return majorIsRow ? height(major, minor) : height(minor, major);
+	}
+};
+
+inline int wrap(int i, int n)
+{
+	i %= n;
+	return i < 0 ? i + n : i;
+}
+
+//What the ray towards the light sees further along a line: 'horizon' is the highest the surface
+//reaches, 'floor' the lowest, both lowered by how much the ray climbs to get there. A ray that
+//stays below the floor runs under the surface up to the border and leaves the terrain through
+//its open side without crossing a triangle, so it is not in shadow.
+struct Sight
+{
+	float horizon, floor;
+};
+
+const Sight nothingInSight = { -FLT_MAX, FLT_MAX };
+
+//Sight of every vertex of line 'major' from the vertices and sight of line 'previous', one step
+//further towards the light. 'shift' is how far the light line moves on the minor axis per step,
+//'rise' how much the ray climbs per step.
+void sweepLine(const SweepGrid & grid, int major, int previous, int step, float shift, float rise,
+	const std::vector<Sight> & previousSight, std::vector<Sight> & sight)
+{
+	int minorCount = grid.minorCount();
+	float whole = std::floor(shift);
+	float fraction = shift - whole;
+	//a diagonal against the split of the quads crosses it in the middle of the quad
+	bool crossesDiagonal = fraction == 0.0f && std::fabs(shift) == 1.0f && step * shift < 0.0f;
+	for (int minor = 0; minor < minorCount; minor++)
+	{
+		int first = minor + int(whole), second = first + 1;
+		if (grid.minorRepeats())
+		{
+			first = wrap(first, minorCount);
+			second = wrap(second, minorCount);
+		}
+		else if (first < 0 || first >= minorCount || (fraction > 0.0f && second >= minorCount))
+		{
+			//the line leaves the terrain at the border
+			sight[minor].horizon = -FLT_MAX;
+			sight[minor].floor = FLT_MAX;
+			continue;
+		}
+
+		float surface = grid.at(previous, first);
+		Sight behind = previousSight[first];
+		if (fraction > 0.0f)
+		{
+			surface += fraction * (grid.at(previous, second) - surface);
+			const Sight & other = previousSight[second];
+			if (behind.horizon > -FLT_MAX && other.horizon > -FLT_MAX)
+				behind.horizon += fraction * (other.horizon - behind.horizon);
+			else
+				behind.horizon = std::max(behind.horizon, other.horizon);
+			if (behind.floor < FLT_MAX && other.floor < FLT_MAX)
+				behind.floor += fraction * (other.floor - behind.floor);
+			else
+				behind.floor = std::min(behind.floor, other.floor);
+		}
+		float highest = std::max(surface, behind.horizon) - rise;
+		float lowest = std::min(surface, behind.floor) - rise;
+
+		if (crossesDiagonal)
+		{
+			//split corners of the quad between the two lines: (low row, low column) and the opposite one
+			int majorLow = step > 0 ? major : previous;
+			int minorLow = shift > 0.0f ? minor : first;
+			int lowRow = grid.majorIsRow ? majorLow : minorLow;
+			int lowColumn = grid.majorIsRow ? minorLow : majorLow;
+			float center = 0.5f * (grid.height(lowRow, lowColumn) + grid.height(wrap(lowRow + 1, grid.rows), lowColumn + 1));
+			highest = std::max(highest, center - 0.5f * rise);
+			lowest = std::min(lowest, center - 0.5f * rise);
+		}
+		sight[minor].horizon = highest;
+		sight[minor].floor = lowest;
+	}
+}
+
+//Moller-Trumbore like glm::intersectRayTriangle, but the triangle borders get a small tolerance:
+//the rays of the exact lights run along the edges of the quads, where the test of the two
+//triangles on either side of an edge can both fail by rounding and let the ray slip through
+bool rayHitsTriangle(const glm::vec3 & origin, const glm::vec3 & direction,
+	const glm::vec3 & v0, const glm::vec3 & v1, const glm::vec3 & v2)
+{
+	const float tolerance = 1e-5f;
+	glm::vec3 e1 = v1 - v0, e2 = v2 - v0;
+	glm::vec3 p = glm::cross(direction, e2);
+	float a = glm::dot(e1, p);
+	if (std::fabs(a) < FLT_EPSILON)
+		return false;
+	float f = 1.0f / a;
+	glm::vec3 s = origin - v0;
+	float u = f * glm::dot(s, p);
+	if (u < -tolerance || u > 1.0f + tolerance)
+		return false;
+	glm::vec3 q = glm::cross(s, e1);
+	float v = f * glm::dot(direction, q);
+	if (v < -tolerance || u + v > 1.0f + tolerance)
+		return false;
+	return f * glm::dot(e2, q) > 0.0f;
+}
+
+} // namespace
+
+void terrainShadows(const float * heights, int columns, int rows, const glm::vec3 & lightDir,
+	std::vector<uint8_t> & shadowed, bool rowsRepeat)
+{
+	shadowed.assign(size_t(rows) * columns, 0);
+	//ray from a vertex towards the light
+	glm::vec3 toLight = -lightDir;
+	if (columns <= 0 || rows <= 0 || (toLight.x == 0.0f && toLight.z == 0.0f))
+		return;
+
+	SweepGrid grid = { heights, columns, rows, std::fabs(toLight.z) >= std::fabs(toLight.x), rowsRepeat };
+	float majorDirection = grid.majorIsRow ? toLight.z : toLight.x;
+	float minorDirection = grid.majorIsRow ? toLight.x : toLight.z;
+	int step = majorDirection > 0.0f ? 1 : -1;
+	float shift = minorDirection / std::fabs(majorDirection);
+	float rise = toLight.y / std::fabs(majorDirection);
+
+	//lines start on the side of the light; repeating rows go round twice, so every vertex has
+	//seen a whole repetition of the terrain in front of it before it is written
+	int majorCount = grid.majorCount();
+	int lines = grid.majorRepeats() ? 2 * majorCount : majorCount;
+	int start = step > 0 ? majorCount - 1 : 0;
+	std::vector<Sight> sight(grid.minorCount(), nothingInSight), next(grid.minorCount());
+	for (int n = 0; n < lines; n++)
+	{
+		int major = wrap(start - n * step, majorCount);
+		if (n > 0)
+		{
+			sweepLine(grid, major, wrap(major + step, majorCount), step, shift, rise, sight, next);
+			sight.swap(next);
+		}
+		if (n < lines - majorCount)
+			continue;
+		for (int minor = 0; minor < grid.minorCount(); minor++)
+		{
+			int row = grid.majorIsRow ? major : minor;
+			int column = grid.majorIsRow ? minor : major;
+			float height = grid.height(row, column);
+			shadowed[size_t(row) * columns + column] = sight[minor].horizon > height && sight[minor].floor <= height;
+		}
+	}
+}
+
+void terrainShadowsRayCast(const float * heights, int columns, int rows, const glm::vec3 & lightDir,
+	std::vector<uint8_t> & shadowed)
+{
+	shadowed.assign(size_t(rows) * columns, 0);
+	//corner of the strips as unrolled rows, so the repetitions line up
+	auto corner = [&](int row, int column) {
+		return glm::vec3(column, heights[size_t(wrap(row, rows)) * columns + column], row);
+	};
+	for (int i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < columns; j++)
+		{
+			glm::vec3 origin = corner(i, j);
+			bool inShadow = false;
+			for (int strip = i - rows; strip < i + rows && !inShadow; strip++)
+			{
+				for (int jj = 0; jj < columns - 1 && !inShadow; jj++)
+				{
+					glm::vec3 vertex_1 = corner(strip, jj), vertex_2 = corner(strip, jj + 1);
+					glm::vec3 vertex_3 = corner(strip + 1, jj + 1), vertex_4 = corner(strip + 1, jj);
+					bool around1 = (strip == i && (jj == j || jj + 1 == j)) || (strip + 1 == i && jj + 1 == j);
+					bool around2 = (strip + 1 == i && (jj == j || jj + 1 == j)) || (strip == i && jj == j);
+					if (!around1)
+						inShadow = rayHitsTriangle(origin, -lightDir, vertex_1, vertex_2, vertex_3);
+					if (!inShadow && !around2)
+						inShadow = rayHitsTriangle(origin, -lightDir, vertex_3, vertex_4, vertex_1);
+				}
+			}
+			shadowed[size_t(i) * columns + j] = inShadow;
+		}
+	}
+}
+
+void terrainShadowsBaseline(const float * heights, int columns, int rows, const glm::vec3 & lightDir,
+	std::vector<uint8_t> & shadowed)
+{
+	struct BaselineVertex
+	{
+		glm::vec3 pos;
+	};
+	int NbVertX = columns, NbVertY = rows;
+	std::vector<std::vector<BaselineVertex> > grid(NbVertY, std::vector<BaselineVertex>(NbVertX));
+	for (int i = 0; i < NbVertY; i++)
+		for (int j = 0; j < NbVertX; j++)
+			grid[i][j].pos = glm::vec3(j, heights[size_t(i) * columns + j], i);
+	shadowed.assign(size_t(rows) * columns, 0);
+
+	//the loop of Terrain::computeShadow as it was; only the vertex type, the result and the
+	//parentheses of the exclusion test (same meaning, for -Wparentheses) changed
+	// i - row; j - column
+	for (int i = 0; i < NbVertY; i++)
+	{
+		for (int j = 0; j < NbVertX; j++)
+		{
+			bool inShadow = false;
+			BaselineVertex vertex = grid[i][j];
+			for (int ii = 0; ii < NbVertY; ii++)
+			{
+				for (int jj = 0; jj < NbVertX - 1; jj++)
+				{
+					BaselineVertex vertex_1, vertex_2, vertex_3, vertex_4;
+					vertex_1 = grid[(i + ii) % NbVertY][jj];
+					vertex_2 = grid[(i + ii) % NbVertY][jj+ 1];
+					vertex_3 = grid[(i + ii + 1) % NbVertY][jj + 1];
+					vertex_4 = grid[(i + ii + 1) % NbVertY][jj];
+					
+					if ((ii == 0 && jj == j) || (ii == 0 && jj + 1 == j) || (ii + 1 == 0 && jj == j) || (ii + 1 == 0 && jj + 1 == j))
+						continue;
+
+					if (i + ii >= NbVertY)
+					{
+						vertex_1.pos.z += NbVertY;
+						vertex_2.pos.z += NbVertY;
+						vertex_3.pos.z += NbVertY;
+						vertex_4.pos.z += NbVertY;
+					}
+
+					glm::vec3 baryPosition;
+					inShadow = glm::intersectRayTriangle(vertex.pos, -lightDir, vertex_1.pos, vertex_2.pos, vertex_3.pos, baryPosition);
+					if (inShadow == true)
+						break;
+					inShadow = glm::intersectRayTriangle(vertex.pos, -lightDir, vertex_3.pos, vertex_4.pos, vertex_1.pos, baryPosition);
+					if (inShadow == true)
+						break;
+				}
+				if (inShadow == true)
+					break;
+			}
+			if (inShadow == true)
+			{
+				shadowed[size_t(i) * columns + j] = 1;
+			}
+				
+		}
+	}
+}
+
+int terrainShadowReach(const glm::vec3 & lightDir, float heightRange, int maxRows)
+{
+	glm::vec3 toLight = -lightDir;
+	//the ray climbs toLight.y / |toLight.z| per row: past heightRange it is above everything
+	int reach;
+	if (toLight.z == 0.0f)
+		reach = 0;
+	else if (toLight.y <= 0.0f)
+		reach = maxRows;
+	else
+		reach = std::min(maxRows, int(heightRange * std::fabs(toLight.z) / toLight.y) + 1);
+	return std::max(reach, 0);
+}
@@ -0,0 +1,239 @@
+//Benchmark for the grid simplification: compares Grid::simplifyMesh (radix sorted cell keys,
+//see clustering.h) against the original std::map based Grid::simplifyMeshLegacy for the
+//resolutions the boss LODs use plus a very fine one, and checks that both produce the same
+//mesh. Also times simplifyMesh on 1, 2, 4 and 8 threads (the output has to be identical) and
+//Grid::simplifyMeshLevels, all the boss levels from one binning pass, against one
+//simplifyMesh call per level. Finally the mesh is written as OBJ and as mesh cache and
+//Grid::simplifyMeshStreaming, which reads the files in small pieces, has to reproduce simplifyMesh.
+//
+//usage: gridbench [file.obj] [repetitions]
+//Without a file, a bumpy sphere of about a million triangles is used.
+
+#include "grid.h"
+#include "meshcache.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static void makeBumpySphere(int rings, Mesh & mesh)
+{
+	const double pi = 3.14159265358979323846;
+	int segments = rings;
+	for (int i = 0; i <= rings; i++)
+	{
+		double theta = pi * i / rings;
+		for (int j = 0; j < segments; j++)
+		{
+			double phi = 2.0 * pi * j / segments;
+			double radius = 1.0 + 0.05 * std::sin(7.0 * theta) * std::cos(11.0 * phi);
+			mesh.vertices.push_back(Vertex(Vec3Df(float(radius * std::sin(theta) * std::cos(phi)),
+				float(radius * std::cos(theta)), float(radius * std::sin(theta) * std::sin(phi)))));
+		}
+	}
+	for (int i = 0; i < rings; i++)
+	{
+		for (int j = 0; j < segments; j++)
+		{
+			unsigned int a = i * segments + j, b = i * segments + (j + 1) % segments;
+			unsigned int c = (i + 1) * segments + (j + 1) % segments, d = (i + 1) * segments + j;
+			mesh.triangles.push_back(Triangle(a, b, c));
+			mesh.triangles.push_back(Triangle(a, c, d));
+		}
+	}
+	mesh.centerNormalsAndBounds();
+}
+
+static bool sameMesh(const Mesh & a, const Mesh & b)
+{
+	if (a.vertices.size() != b.vertices.size() || a.triangles.size() != b.triangles.size())
+		return false;
+	for (size_t i = 0; i < a.vertices.size(); i++)
+	{
+		if (a.vertices[i].p != b.vertices[i].p || a.vertices[i].n != b.vertices[i].n)
+			return false;
+	}
+	for (size_t i = 0; i < a.triangles.size(); i++)
+	{
+		if (memcmp(a.triangles[i].v, b.triangles[i].v, sizeof(a.triangles[i].v)) != 0)
+			return false;
+	}
+	return a.bbOrigin == b.bbOrigin && a.bbEdgeSize == b.bbEdgeSize;
+}
+
+static bool writeObj(const char * filename, const Mesh & mesh)
+{
+	FILE * f = fopen(filename, "w");
+	if (!f)
+		return false;
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+		fprintf(f, "v %.9g %.9g %.9g\n", mesh.vertices[i].p[0], mesh.vertices[i].p[1], mesh.vertices[i].p[2]);
+	for (size_t i = 0; i < mesh.triangles.size(); i++)
+		fprintf(f, "f %u %u %u\n", mesh.triangles[i].v[0] + 1, mesh.triangles[i].v[1] + 1, mesh.triangles[i].v[2] + 1);
+	return fclose(f) == 0;
+}
+
+static bool writeCache(const char * filename, const Mesh & mesh)
+{
+	VertexLayout layout;
+	layout.stride = 3 * sizeof(float);
+	VertexAttribute position = { 0, 3, 0, SEMANTIC_POSITION };
+	layout.attributes.push_back(position);
+	std::vector<float> positions;
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		for (int k = 0; k < 3; k++)
+			positions.push_back(mesh.vertices[i].p[k]);
+	}
+	return writeMeshCache(filename, 0, layout, &positions[0], mesh.vertices.size(),
+		reinterpret_cast<const uint32_t *>(mesh.triangles[0].v), 3 * mesh.triangles.size());
+}
+
+int main(int argc, char ** argv)
+{
+	Mesh mesh;
+	std::string name = "synthetic sphere";
+	if (argc > 1)
+	{
+		name = argv[1];
+		if (!mesh.loadMesh(argv[1]))
+		{
+			std::cerr << "cannot open " << name << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	else
+		makeBumpySphere(707, mesh);
+	int repetitions = argc > 2 ? atoi(argv[2]) : 3;
+	if (repetitions < 1)
+		repetitions = 1;
+	std::cout << name << ": " << mesh.vertices.size() << " vertices, " << mesh.triangles.size() << " triangles" << std::endl;
+
+	Grid grid;
+	bool ok = true;
+	//the boss resolutions, and one beyond what 32 bit linear cell keys could address
+	const unsigned int legacyResolutions[] = { 70, 60, 50, 40, 30, 2000 };
+	for (unsigned int r : legacyResolutions)
+	{
+		//the legacy version takes seconds, it only runs once
+		auto t0 = std::chrono::high_resolution_clock::now();
+		Mesh legacy = grid.simplifyMeshLegacy(mesh, r);
+		auto t1 = std::chrono::high_resolution_clock::now();
+		double legacyTime = std::chrono::duration<double>(t1 - t0).count();
+
+		double best = 1e30;
+		Mesh fast;
+		for (int i = 0; i < repetitions; i++)
+		{
+			auto t2 = std::chrono::high_resolution_clock::now();
+			fast = grid.simplifyMesh(mesh, r);
+			auto t3 = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double>(t3 - t2).count());
+		}
+
+		bool same = sameMesh(legacy, fast);
+		std::cout << "r = " << r << ": " << fast.vertices.size() << " vertices, " << fast.triangles.size()
+			<< " triangles, simplifyMeshLegacy " << legacyTime * 1000.0 << " ms, simplifyMesh " << best * 1000.0
+			<< " ms (" << legacyTime / best << "x)" << (same ? "" : "  MISMATCH") << std::endl;
+		ok = ok && same;
+	}
+
+	//thread counts, against the single threaded result
+	const unsigned int threadResolutions[] = { 70, 30 };
+	for (unsigned int r : threadResolutions)
+	{
+		Mesh reference;
+		double serial = 0.0;
+		for (unsigned int threads = 1; threads <= 8; threads *= 2)
+		{
+			double best = 1e30;
+			Mesh result;
+			for (int i = 0; i < repetitions; i++)
+			{
+				auto t0 = std::chrono::high_resolution_clock::now();
+				result = grid.simplifyMesh(mesh, r, threads);
+				auto t1 = std::chrono::high_resolution_clock::now();
+				best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+			}
+			if (threads == 1)
+			{
+				reference = result;
+				serial = best;
+			}
+			bool same = sameMesh(reference, result);
+			std::cout << "r = " << r << ", " << threads << " thread(s): simplifyMesh " << best * 1000.0 << " ms ("
+				<< serial / best << "x)" << (same ? "" : "  MISMATCH") << std::endl;
+			ok = ok && same;
+		}
+	}
+
+	//all boss levels at once against one simplifyMesh call per level
+	std::vector<unsigned int> resolutions;
+	for (unsigned int r = 70; r >= 30; r -= 10)
+		resolutions.push_back(r);
+	double separate = 1e30, pyramid = 1e30;
+	std::vector<Mesh> single, levels;
+	for (int i = 0; i < repetitions; i++)
+	{
+		auto t0 = std::chrono::high_resolution_clock::now();
+		single.clear();
+		for (size_t l = 0; l < resolutions.size(); l++)
+			single.push_back(grid.simplifyMesh(mesh, resolutions[l]));
+		auto t1 = std::chrono::high_resolution_clock::now();
+		levels = grid.simplifyMeshLevels(mesh, resolutions);
+		auto t2 = std::chrono::high_resolution_clock::now();
+		separate = std::min(separate, std::chrono::duration<double>(t1 - t0).count());
+		pyramid = std::min(pyramid, std::chrono::duration<double>(t2 - t1).count());
+	}
+	std::cout << "levels r = 70..30: " << resolutions.size() << "x simplifyMesh " << separate * 1000.0
+		<< " ms, simplifyMeshLevels " << pyramid * 1000.0 << " ms (" << separate / pyramid << "x)" << std::endl;
+	for (size_t l = 0; l < resolutions.size(); l++)
+	{
+		std::cout << "    r = " << resolutions[l] << ": " << levels[l].vertices.size() << " vertices, "
+			<< levels[l].triangles.size() << " triangles (simplifyMesh: " << single[l].vertices.size() << ", "
+			<< single[l].triangles.size() << ")" << std::endl;
+	}
+	//the finest level is not reduced from another one, so it has to be exactly simplifyMesh
+	if (!sameMesh(levels[0], single[0]))
+	{
+		std::cerr << "MISMATCH: the finest level differs from simplifyMesh" << std::endl;
+		ok = false;
+	}
+
+	//streamed from files, in 1 MB pieces
+	const char * files[] = { "gridbench.tmp.obj", "gridbench.tmp.mesh" };
+	if (!writeObj(files[0], mesh) || !writeCache(files[1], mesh))
+	{
+		std::cerr << "cannot write the temporary mesh files" << std::endl;
+		ok = false;
+	}
+	else
+	{
+		Mesh reference = grid.simplifyMesh(mesh, 70);
+		for (int f = 0; f < 2; f++)
+		{
+			Mesh streamed;
+			auto t0 = std::chrono::high_resolution_clock::now();
+			bool read = grid.simplifyMeshStreaming(files[f], 70, streamed, 1 << 20);
+			auto t1 = std::chrono::high_resolution_clock::now();
+			bool same = read && sameMesh(reference, streamed);
+			std::cout << "r = 70 streamed from " << files[f] << ": " << streamed.vertices.size() << " vertices, "
+				<< streamed.triangles.size() << " triangles, " << std::chrono::duration<double>(t1 - t0).count() * 1000.0
+				<< " ms" << (same ? "" : "  MISMATCH") << std::endl;
+			ok = ok && same;
+		}
+	}
+	remove(files[0]);
+	remove(files[1]);
+
+	if (!ok)
+	{
+		std::cerr << "MISMATCH: the simplifications produced different meshes" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "output identical" << std::endl;
+	return 0;
+}
@@ -0,0 +1,70 @@
+//Offline baking of the simplified levels: loads the source mesh of every LodAsset, runs the
+//grid simplifier for the resolutions the asset declares (or the ones that meet its error bounds,
+//see meshdistance.h) and writes all levels into one mesh cache with a level table, keyed by the
+//source hash and the simplifier parameters. The game then maps these files instead of
+//simplifying at startup (the boss damage states).
+//
+//usage: lodbake [-f]
+//Up to date caches are skipped, -f rebakes everything. Returns non zero if an asset fails.
+
+#include "lodasset.h"
+#include "meshcache.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static bool bake(const LodAsset & asset, bool force)
+{
+	uint64_t hash = 0;
+	if (!hashFiles(std::vector<std::string>(1, asset.sourceFile), hash))
+	{
+		std::cerr << asset.name << ": cannot read " << asset.sourceFile << std::endl;
+		return false;
+	}
+	uint64_t parameters = asset.parameters();
+	hash = hashParameters(hash, &parameters, sizeof(parameters));
+	MeshCache cache;
+	if (!force && cache.open(asset.cacheFile, hash, vertexLayout<BossVertex>()))
+	{
+		std::cout << asset.name << ": " << asset.cacheFile << " is up to date" << std::endl;
+		return true;
+	}
+	cache.close();
+
+	auto t0 = std::chrono::high_resolution_clock::now();
+	std::vector<BossVertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<LodLevel> levels;
+	std::string error;
+	MeshOptimizeReport report;
+	if (!bakeLodAsset(asset, vertices, indices, levels, error, &report))
+	{
+		std::cerr << asset.name << ": " << error << std::endl;
+		return false;
+	}
+	if (!writeMeshCache(asset.cacheFile, hash, vertexLayout<BossVertex>(), vertices.empty() ? 0 : &vertices[0], vertices.size(),
+		indices.empty() ? 0 : &indices[0], indices.size(), levels.empty() ? 0 : &levels[0], levels.size()))
+	{
+		std::cerr << asset.name << ": cannot write " << asset.cacheFile << std::endl;
+		return false;
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	std::cout << asset.name << ": " << asset.sourceFile << ", " << levels.size() << " levels, "
+		<< vertices.size() << " vertices (" << vertices.size() * sizeof(BossVertex) / 1024 << " KB) -> " << asset.cacheFile
+		<< " (" << std::chrono::duration<double>(t1 - t0).count() * 1000.0 << " ms)" << std::endl;
+	std::cout << "    " << report << std::endl;
+	std::cout << "    triangles:";
+	for (size_t l = 0; l < levels.size(); l++)
+		std::cout << " " << levels[l].indexCount / 3;
+	std::cout << std::endl;
+	return true;
+}
+
+int main(int argc, char ** argv)
+{
+	bool force = argc > 1 && strcmp(argv[1], "-f") == 0;
+
+	bool ok = bake(bossDamageAsset(), force);
+	return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,346 @@
+//Benchmark for the structure of arrays mesh kernels (meshsoa.h): times centerAndScaleToUnit,
+//computeVertexNormals and computeBoundingCube of the original array of structures code
+//(Vertex/Triangle with a vtable, Vec3Df math, copied here as the reference) against the
+//scalar, SSE and AVX kernels, and Mesh::centerNormalsAndBounds (in place on the vertices, see
+//mesh.cpp) against the same three calls of the reference. Checks that every variant matches
+//the reference within tolerance, and that the parallel normals (all weightings) are the same
+//for every thread count.
+//
+//usage: meshbench [triangles] [repetitions]
+//The mesh is a bumpy sphere of about 'triangles' triangles (default one million).
+
+#include "meshsoa.h"
+#include "mesh.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+/************************************************************
+ * Reference: the Mesh code before meshsoa.h
+ ************************************************************/
+
+class LegacyVertex {
+public:
+	LegacyVertex() {}
+	LegacyVertex(const Vec3Df & p) : p(p) {}
+	virtual ~LegacyVertex() {}
+	Vec3Df p;
+	Vec3Df n;
+};
+
+class LegacyTriangle {
+public:
+	LegacyTriangle() { v[0] = v[1] = v[2] = 0; }
+	LegacyTriangle(unsigned int v0, unsigned int v1, unsigned int v2) { v[0] = v0; v[1] = v1; v[2] = v2; }
+	virtual ~LegacyTriangle() {}
+	unsigned int v[3];
+};
+
+struct LegacyMesh
+{
+	std::vector<LegacyVertex> vertices;
+	std::vector<LegacyTriangle> triangles;
+	Vec3Df bbOrigin;
+	float bbEdgeSize;
+
+	void computeBoundingCube() {
+		Vec3Df minPoint, maxPoint;
+		minPoint = maxPoint = vertices[0].p;
+		for (unsigned int i = 1; i < vertices.size(); i++)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				minPoint[j] = minPoint[j] < (vertices[i].p)[j] ? minPoint[j] : (vertices[i].p)[j];
+				maxPoint[j] = maxPoint[j] > (vertices[i].p)[j] ? maxPoint[j] : (vertices[i].p)[j];
+			}
+		}
+		bbOrigin = minPoint;
+		maxPoint -= minPoint;
+		bbEdgeSize = std::max(std::max(maxPoint[0], maxPoint[1]), maxPoint[2]);
+	}
+
+	void computeVertexNormals() {
+		for (unsigned int i = 0; i < vertices.size(); i++)
+			vertices[i].n = Vec3Df(0.0, 0.0, 0.0);
+		for (unsigned int i = 0; i < triangles.size(); i++) {
+			Vec3Df edge01 = vertices[triangles[i].v[1]].p - vertices[triangles[i].v[0]].p;
+			Vec3Df edge02 = vertices[triangles[i].v[2]].p - vertices[triangles[i].v[0]].p;
+			Vec3Df n = Vec3Df::crossProduct(edge01, edge02);
+			n.normalize();
+			for (unsigned int j = 0; j < 3; j++)
+				vertices[triangles[i].v[j]].n += n;
+		}
+		for (unsigned int i = 0; i < vertices.size(); i++)
+			vertices[i].n.normalize();
+	}
+
+	void centerAndScaleToUnit() {
+		Vec3Df c;
+		for (unsigned int i = 0; i < vertices.size(); i++)
+			c += vertices[i].p;
+		c /= vertices.size();
+		float maxD = Vec3Df::distance(vertices[0].p, c);
+		for (unsigned int i = 0; i < vertices.size(); i++) {
+			float m = Vec3Df::distance(vertices[i].p, c);
+			if (m > maxD)
+				maxD = m;
+		}
+		for (unsigned int i = 0; i < vertices.size(); i++)
+			vertices[i].p = (vertices[i].p - c) / maxD;
+	}
+};
+
+/************************************************************
+ * Test mesh and timing
+ ************************************************************/
+
+static void makeBumpySphere(size_t triangleCount, LegacyMesh & mesh)
+{
+	int rings = (int)std::sqrt(triangleCount / 2.0);
+	if (rings < 4)
+		rings = 4;
+	int segments = rings;
+	const double pi = 3.14159265358979323846;
+	for (int i = 0; i <= rings; i++)
+	{
+		double theta = pi * i / rings;
+		for (int j = 0; j < segments; j++)
+		{
+			double phi = 2.0 * pi * j / segments;
+			double r = 2.0 + 0.05 * std::sin(7.0 * theta) * std::cos(11.0 * phi);
+			mesh.vertices.push_back(LegacyVertex(Vec3Df(float(r * std::sin(theta) * std::cos(phi) + 0.3),
+				float(r * std::cos(theta) - 0.1), float(r * std::sin(theta) * std::sin(phi) + 0.7))));
+		}
+	}
+	for (int i = 0; i < rings; i++)
+	{
+		for (int j = 0; j < segments; j++)
+		{
+			unsigned int a = i * segments + j, b = i * segments + (j + 1) % segments;
+			unsigned int c = (i + 1) * segments + (j + 1) % segments, d = (i + 1) * segments + j;
+			mesh.triangles.push_back(LegacyTriangle(a, b, c));
+			mesh.triangles.push_back(LegacyTriangle(a, c, d));
+		}
+	}
+}
+
+template <typename Function>
+static double bestTime(int repetitions, Function fn)
+{
+	double best = 1e30;
+	for (int r = 0; r < repetitions; r++)
+	{
+		auto t0 = std::chrono::high_resolution_clock::now();
+		fn();
+		auto t1 = std::chrono::high_resolution_clock::now();
+		best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+	}
+	return best * 1000.0;
+}
+
+struct Timings
+{
+	double center, normals, bounds;
+};
+
+static float maxDifference(const LegacyMesh & reference, const MeshSoA & soa, bool normals)
+{
+	float difference = 0.0f;
+	for (size_t i = 0; i < reference.vertices.size(); i++)
+	{
+		const Vec3Df & a = normals ? reference.vertices[i].n : reference.vertices[i].p;
+		Vec3Df b = normals ? Vec3Df(soa.nx[i], soa.ny[i], soa.nz[i]) : Vec3Df(soa.px[i], soa.py[i], soa.pz[i]);
+		for (int j = 0; j < 3; j++)
+			difference = std::max(difference, std::fabs(a[j] - b[j]));
+	}
+	return difference;
+}
+
+int main(int argc, char ** argv)
+{
+	size_t triangleCount = argc > 1 ? strtoul(argv[1], 0, 10) : 1000000;
+	int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+	if (repetitions < 1)
+		repetitions = 1;
+	//the reference sums the mean of a million floats in a float, the kernels do not, so the
+	//centered positions differ by that rounding; normals and bounds are computed from the
+	//same positions and must match (in practice bit for bit)
+	const float positionTolerance = 1e-4f;
+	const float tolerance = 1e-6f;
+
+	LegacyMesh source;
+	makeBumpySphere(triangleCount, source);
+	std::cout << source.vertices.size() << " vertices, " << source.triangles.size() << " triangles, best of "
+		<< repetitions << ", compiled SIMD level: " << simdLevelName(bestSimdLevel()) << std::endl;
+
+	//reference
+	LegacyMesh reference = source;
+	Timings legacy;
+	legacy.center = bestTime(repetitions, [&] {
+		reference.vertices = source.vertices;
+		reference.centerAndScaleToUnit();
+	}) - bestTime(repetitions, [&] { reference.vertices = source.vertices; });
+	reference.vertices = source.vertices;
+	reference.centerAndScaleToUnit();
+	legacy.normals = bestTime(repetitions, [&] { reference.computeVertexNormals(); });
+	legacy.bounds = bestTime(repetitions, [&] { reference.computeBoundingCube(); });
+
+	MeshSoA input;
+	input.resize(source.vertices.size());
+	for (size_t i = 0; i < source.vertices.size(); i++)
+	{
+		input.px[i] = source.vertices[i].p[0];
+		input.py[i] = source.vertices[i].p[1];
+		input.pz[i] = source.vertices[i].p[2];
+	}
+	input.triangles.resize(source.triangles.size());
+	for (size_t i = 0; i < source.triangles.size(); i++)
+	{
+		for (int j = 0; j < 3; j++)
+			input.triangles[i].v[j] = source.triangles[i].v[j];
+	}
+
+	bool ok = true;
+	std::cout << "variant        center     normals    bounds     (ms, speedup over the reference)" << std::endl;
+	std::cout << "reference      " << legacy.center << "  " << legacy.normals << "  " << legacy.bounds << std::endl;
+	for (int level = SIMD_SCALAR; level <= bestSimdLevel(); level++)
+	{
+		SimdLevel simd = SimdLevel(level);
+		MeshSoA soa = input;
+		Timings t;
+		t.center = bestTime(repetitions, [&] {
+			soa.px = input.px; soa.py = input.py; soa.pz = input.pz;
+			soa.centerAndScaleToUnit(simd);
+		}) - bestTime(repetitions, [&] { soa.px = input.px; soa.py = input.py; soa.pz = input.pz; });
+		soa.px = input.px; soa.py = input.py; soa.pz = input.pz;
+		soa.centerAndScaleToUnit(simd);
+		float positionError = maxDifference(reference, soa, false);
+
+		//normals and bounds from the exact same positions as the reference
+		for (size_t i = 0; i < reference.vertices.size(); i++)
+		{
+			soa.px[i] = reference.vertices[i].p[0];
+			soa.py[i] = reference.vertices[i].p[1];
+			soa.pz[i] = reference.vertices[i].p[2];
+		}
+		t.normals = bestTime(repetitions, [&] {
+			soaComputeVertexNormals(&soa.px[0], &soa.py[0], &soa.pz[0], soa.vertexCount(), soa.triangles[0].v,
+				soa.triangles.size(), &soa.nx[0], &soa.ny[0], &soa.nz[0], NORMAL_WEIGHT_UNIFORM, 1, simd);
+		});
+		t.bounds = bestTime(repetitions, [&] { soa.computeBoundingCube(simd); });
+
+		float normalError = maxDifference(reference, soa, true);
+		float boundsError = std::fabs(soa.bbEdgeSize - reference.bbEdgeSize);
+		for (int j = 0; j < 3; j++)
+			boundsError = std::max(boundsError, std::fabs(soa.bbOrigin[j] - reference.bbOrigin[j]));
+
+		std::cout << simdLevelName(simd) << (simd == SIMD_SCALAR ? "         " : "            ")
+			<< t.center << " (" << legacy.center / t.center << "x)  "
+			<< t.normals << " (" << legacy.normals / t.normals << "x)  "
+			<< t.bounds << " (" << legacy.bounds / t.bounds << "x)" << std::endl;
+		std::cout << "    max difference: positions " << positionError << ", normals " << normalError
+			<< ", bounds " << boundsError << std::endl;
+		if (!(positionError <= positionTolerance && normalError <= tolerance && boundsError <= tolerance))
+		{
+			std::cerr << "MISMATCH: " << simdLevelName(simd) << " differs from the reference" << std::endl;
+			ok = false;
+		}
+	}
+
+	//parallel normals: time per thread count, and the same bits for every thread count
+	MeshSoA centered = input;
+	for (size_t i = 0; i < reference.vertices.size(); i++)
+	{
+		centered.px[i] = reference.vertices[i].p[0];
+		centered.py[i] = reference.vertices[i].p[1];
+		centered.pz[i] = reference.vertices[i].p[2];
+	}
+	const char * weightingNames[] = { "uniform", "area", "angle" };
+	//always a few counts above one, so the check also runs on small machines
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads <= std::max(8u, hardwareThreads()); threads *= 2)
+		threadCounts.push_back(threads);
+	if (threadCounts.back() != hardwareThreads() && hardwareThreads() > 8)
+		threadCounts.push_back(hardwareThreads());
+	for (int weighting = NORMAL_WEIGHT_UNIFORM; weighting <= NORMAL_WEIGHT_ANGLE; weighting++)
+	{
+		std::cout << "normals, " << weightingNames[weighting] << " weights:";
+		std::vector<float> first;
+		for (size_t k = 0; k < threadCounts.size(); k++)
+		{
+			MeshSoA & m = centered;
+			double time = bestTime(repetitions, [&] {
+				soaComputeVertexNormals(&m.px[0], &m.py[0], &m.pz[0], m.vertexCount(), m.triangles[0].v, m.triangles.size(),
+					&m.nx[0], &m.ny[0], &m.nz[0], NormalWeighting(weighting), threadCounts[k]);
+			});
+			std::cout << "  " << threadCounts[k] << (threadCounts[k] == 1 ? " thread " : " threads ") << time << " ms";
+
+			std::vector<float> normals(m.nx);
+			normals.insert(normals.end(), m.ny.begin(), m.ny.end());
+			normals.insert(normals.end(), m.nz.begin(), m.nz.end());
+			if (k == 0)
+				first.swap(normals);
+			else if (memcmp(&first[0], &normals[0], first.size() * sizeof(float)) != 0)
+			{
+				std::cerr << std::endl << "MISMATCH: " << weightingNames[weighting] << " normals depend on the thread count" << std::endl;
+				ok = false;
+			}
+		}
+		std::cout << std::endl;
+	}
+
+	//what existing callers of Mesh pay, the three steps from fresh positions, against the same
+	//calls of the reference
+	Mesh mesh;
+	input.toMesh(mesh);
+	const Mesh loaded = mesh;
+	double referenceAll = bestTime(repetitions, [&] {
+		reference.vertices = source.vertices;
+		reference.centerAndScaleToUnit();
+		reference.computeVertexNormals();
+		reference.computeBoundingCube();
+	}) - bestTime(repetitions, [&] { reference.vertices = source.vertices; });
+	double adapter = bestTime(repetitions, [&] {
+		mesh.vertices = loaded.vertices;
+		mesh.centerNormalsAndBounds();
+	}) - bestTime(repetitions, [&] { mesh.vertices = loaded.vertices; });
+	std::cout << "Mesh::centerNormalsAndBounds: " << adapter << " ms, reference " << referenceAll << " ms ("
+		<< referenceAll / adapter << "x)" << std::endl;
+	reference.vertices = source.vertices;
+	reference.centerAndScaleToUnit();
+	reference.computeVertexNormals();
+	reference.computeBoundingCube();
+	mesh.vertices = loaded.vertices;
+	mesh.centerAndScaleToUnit();
+	MeshSoA adapted;
+	adapted.fromMesh(mesh);
+	float positionError = maxDifference(reference, adapted, false);
+	//normals and bounds from the exact same positions as the reference, as for the kernels
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+		mesh.vertices[i].p = reference.vertices[i].p;
+	mesh.computeVertexNormals();
+	mesh.computeBoundingCube();
+	adapted.fromMesh(mesh);
+	float normalError = maxDifference(reference, adapted, true);
+	float boundsError = std::fabs(mesh.bbEdgeSize - reference.bbEdgeSize);
+	for (int j = 0; j < 3; j++)
+		boundsError = std::max(boundsError, std::fabs(mesh.bbOrigin[j] - reference.bbOrigin[j]));
+	std::cout << "    max difference: positions " << positionError << ", normals " << normalError
+		<< ", bounds " << boundsError << std::endl;
+	if (!(positionError <= positionTolerance && normalError <= tolerance && boundsError <= tolerance))
+	{
+		std::cerr << "MISMATCH: Mesh differs from the reference" << std::endl;
+		ok = false;
+	}
+
+	if (!ok)
+		return EXIT_FAILURE;
+	std::cout << "results match the reference (positions within " << positionTolerance
+		<< ", normals and bounds within " << tolerance << ")" << std::endl;
+	return 0;
+}
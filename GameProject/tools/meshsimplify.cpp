@@ -0,0 +1,57 @@
+//Offline vertex clustering for source meshes that may be larger than memory: streams an OBJ
+//or mesh cache file through Grid::simplifyMeshStreaming and writes the simplified mesh as OBJ
+//(positions and normals, centered and scaled to the unit cube like simplifyMesh).
+//
+//usage: meshsimplify input r output.obj [chunk MB]
+
+#include "grid.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+static bool writeObj(const char * filename, const Mesh & mesh)
+{
+	FILE * f = fopen(filename, "w");
+	if (!f)
+		return false;
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+		fprintf(f, "v %.9g %.9g %.9g\n", mesh.vertices[i].p[0], mesh.vertices[i].p[1], mesh.vertices[i].p[2]);
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+		fprintf(f, "vn %.9g %.9g %.9g\n", mesh.vertices[i].n[0], mesh.vertices[i].n[1], mesh.vertices[i].n[2]);
+	for (size_t i = 0; i < mesh.triangles.size(); i++)
+	{
+		unsigned int a = mesh.triangles[i].v[0] + 1, b = mesh.triangles[i].v[1] + 1, c = mesh.triangles[i].v[2] + 1;
+		fprintf(f, "f %u//%u %u//%u %u//%u\n", a, a, b, b, c, c);
+	}
+	return fclose(f) == 0;
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc < 4 || atoi(argv[2]) < 1)
+	{
+		std::cerr << "usage: meshsimplify input r output.obj [chunk MB]" << std::endl;
+		return EXIT_FAILURE;
+	}
+	unsigned int r = (unsigned int)atoi(argv[2]);
+	size_t chunkSize = size_t(argc > 4 ? atoi(argv[4]) : 64) << 20;
+
+	auto t0 = std::chrono::high_resolution_clock::now();
+	Grid grid;
+	Mesh simplified;
+	if (!grid.simplifyMeshStreaming(argv[1], r, simplified, chunkSize))
+	{
+		std::cerr << "cannot simplify " << argv[1] << std::endl;
+		return EXIT_FAILURE;
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	if (!writeObj(argv[3], simplified))
+	{
+		std::cerr << "cannot write " << argv[3] << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << argv[1] << " -> " << argv[3] << ": " << simplified.vertices.size() << " vertices, "
+		<< simplified.triangles.size() << " triangles in " << std::chrono::duration<double>(t1 - t0).count() << " s" << std::endl;
+	return 0;
+}
@@ -0,0 +1,84 @@
+//Offline baking of the morph target characters: reads the base and pose OBJ files of every
+//character, checks that all poses have the same topology as the base, and writes one mesh
+//cache per character in the exact vertex layout the game uploads (AniviaVertex, EnemyVertex,
+//BossVertex, VertexBasic), welded to unique vertices plus an index buffer and optimized for
+//the vertex cache, overdraw and vertex fetch (ACMR/ATVR before and after are reported),
+//followed by the levels of detail of the character (MorphAsset::lodResolutions).
+//The game then maps these files instead of parsing the OBJs and simplifying the meshes.
+//
+//usage: morphbake [-f]
+//Up to date caches are skipped, -f rebakes everything. Returns non zero if a character fails.
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include "morphtargets.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+template <typename T>
+static bool bake(const MorphAsset & asset, bool force)
+{
+	uint64_t hash = 0;
+	if (!hashFiles(asset.sources(), hash))
+	{
+		std::cerr << asset.name << ": cannot read the source files" << std::endl;
+		return false;
+	}
+	uint64_t parameters = asset.parameters();
+	hash = hashParameters(hash, &parameters, sizeof(parameters));
+	MeshCache cache;
+	if (!force && cache.open(asset.cacheFile, hash, vertexLayout<T>()))
+	{
+		std::cout << asset.name << ": " << asset.cacheFile << " is up to date" << std::endl;
+		return true;
+	}
+	cache.close();
+
+	auto t0 = std::chrono::high_resolution_clock::now();
+	std::vector<T> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<LodLevel> levels;
+	std::string error;
+	MeshOptimizeReport report;
+	if (!bakeMorphAsset(asset, vertices, indices, levels, error, &report))
+	{
+		std::cerr << asset.name << ": " << error << std::endl;
+		return false;
+	}
+	if (!writeMeshCache(asset.cacheFile, hash, vertexLayout<T>(), vertices.empty() ? 0 : &vertices[0], vertices.size(),
+		indices.empty() ? 0 : &indices[0], indices.size(), levels.empty() ? 0 : &levels[0], levels.size()))
+	{
+		std::cerr << asset.name << ": cannot write " << asset.cacheFile << std::endl;
+		return false;
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	size_t fullIndices = levels.empty() ? indices.size() : levels[0].indexCount;
+	std::cout << asset.name << ": " << asset.targets.size() << " morph targets, " << fullIndices / 3 << " triangles, "
+		<< vertices.size() << " unique vertices (" << fullIndices * sizeof(T) / 1024 << " KB de-indexed, "
+		<< vertices.size() * sizeof(T) / 1024 << " KB welded) -> " << asset.cacheFile
+		<< " (" << std::chrono::duration<double>(t1 - t0).count() * 1000.0 << " ms)" << std::endl;
+	std::cout << "    " << report << std::endl;
+	if (levels.size() > 1)
+	{
+		std::cout << "    levels of detail:";
+		for (size_t l = 1; l < levels.size(); l++)
+			std::cout << " " << levels[l].indexCount / 3;
+		std::cout << " triangles" << std::endl;
+	}
+	return true;
+}
+
+int main(int argc, char ** argv)
+{
+	bool force = argc > 1 && strcmp(argv[1], "-f") == 0;
+
+	bool ok = true;
+	ok = bake<AniviaVertex>(aniviaAsset(), force) && ok;
+	ok = bake<EnemyVertex>(enemyAsset(), force) && ok;
+	ok = bake<BossVertex>(bossAsset(), force) && ok;
+	ok = bake<VertexBasic>(iceBergAsset(), force) && ok;
+	return ok ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+//Benchmark for the OBJ loaders of Mesh: compares the memory mapped, multi-threaded
+//Mesh::loadMesh against the original fgets/sscanf based Mesh::loadMeshLegacy,
+//reports the throughput of both and checks that they produce the same mesh.
+//
+//usage: objbench [file.obj] [repetitions]
+//Without a file, a synthetic OBJ (a sphere made of quads, with texcoords and normals) is generated.
+
+#include "mesh.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static double fileSizeMB(const char * filename)
+{
+	FILE * f = fopen(filename, "rb");
+	if (!f)
+		return 0.0;
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fclose(f);
+	return size / (1024.0 * 1024.0);
+}
+
+static void writeSyntheticObj(const char * filename, int rings, int segments)
+{
+	FILE * f = fopen(filename, "w");
+	const double pi = 3.14159265358979323846;
+	for (int i = 0; i <= rings; i++)
+	{
+		double theta = pi * i / rings;
+		for (int j = 0; j < segments; j++)
+		{
+			double phi = 2.0 * pi * j / segments;
+			double x = sin(theta) * cos(phi), y = cos(theta), z = sin(theta) * sin(phi);
+			fprintf(f, "v %f %f %f\n", x * 1.5, y * 1.5, z * 1.5);
+			fprintf(f, "vt %f %f\n", j / double(segments), i / double(rings));
+			fprintf(f, "vn %f %f %f\n", x, y, z);
+		}
+	}
+	for (int i = 0; i < rings; i++)
+	{
+		for (int j = 0; j < segments; j++)
+		{
+			int a = i * segments + j + 1;
+			int b = i * segments + (j + 1) % segments + 1;
+			int c = (i + 1) * segments + (j + 1) % segments + 1;
+			int d = (i + 1) * segments + j + 1;
+			fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+		}
+	}
+	fclose(f);
+}
+
+static bool sameMesh(const Mesh & a, const Mesh & b)
+{
+	if (a.vertices.size() != b.vertices.size() || a.triangles.size() != b.triangles.size())
+		return false;
+	for (size_t i = 0; i < a.vertices.size(); i++)
+	{
+		if (a.vertices[i].p != b.vertices[i].p || a.vertices[i].n != b.vertices[i].n)
+			return false;
+	}
+	for (size_t i = 0; i < a.triangles.size(); i++)
+	{
+		if (memcmp(a.triangles[i].v, b.triangles[i].v, sizeof(a.triangles[i].v)) != 0)
+			return false;
+	}
+	return a.bbOrigin == b.bbOrigin && a.bbEdgeSize == b.bbEdgeSize;
+}
+
+int main(int argc, char ** argv)
+{
+	std::string filename = "objbench_synthetic.obj";
+	if (argc > 1)
+		filename = argv[1];
+	else
+		writeSyntheticObj(filename.c_str(), 700, 1000);
+	int repetitions = argc > 2 ? atoi(argv[2]) : 3;
+	if (repetitions < 1)
+		repetitions = 1;
+
+	double sizeMB = fileSizeMB(filename.c_str());
+	double bestLegacy = 1e30, bestFast = 1e30;
+	Mesh legacy, fast;
+	for (int r = 0; r < repetitions; r++)
+	{
+		legacy = Mesh();
+		auto t0 = std::chrono::high_resolution_clock::now();
+		if (!legacy.loadMeshLegacy(filename.c_str()))
+		{
+			std::cerr << "cannot open " << filename << std::endl;
+			return EXIT_FAILURE;
+		}
+		auto t1 = std::chrono::high_resolution_clock::now();
+		fast = Mesh();
+		fast.loadMesh(filename.c_str());
+		auto t2 = std::chrono::high_resolution_clock::now();
+		bestLegacy = std::min(bestLegacy, std::chrono::duration<double>(t1 - t0).count());
+		bestFast = std::min(bestFast, std::chrono::duration<double>(t2 - t1).count());
+	}
+
+	std::cout << filename << ": " << sizeMB << " MB, " << fast.vertices.size() << " vertices, "
+		<< fast.triangles.size() << " triangles" << std::endl;
+	std::cout << "loadMeshLegacy: " << bestLegacy * 1000.0 << " ms, " << sizeMB / bestLegacy << " MB/s" << std::endl;
+	std::cout << "loadMesh:       " << bestFast * 1000.0 << " ms, " << sizeMB / bestFast << " MB/s" << std::endl;
+	std::cout << "speedup:        " << bestLegacy / bestFast << "x" << std::endl;
+
+	if (!sameMesh(legacy, fast))
+	{
+		std::cerr << "MISMATCH: loaders produced different meshes" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "output identical" << std::endl;
+	return 0;
+}
@@ -0,0 +1,173 @@
+//Benchmark for the terrain shadows: checks terrainShadows (horizon sweep, see terrainshadow.h)
+//against the exact ray cast on random terrains like the ones Terrain generates (heights 0..1)
+//and four times as steep, for lights along the rows, the columns and the diagonals (these have
+//to match exactly) and for a few other directions (interpolated, the differing vertices are
+//reported). The loop of the original Terrain::computeShadow does not cast the same rays (see
+//terrainShadowsBaseline), so it is only compared: the vertices it shadows and the sweep does not
+//and the other way round, and a map of them on the game terrain. Then times the ray cast up to
+//64 x 64 and the sweep up to 2048 x 2048.
+//
+//usage: shadowbench [repetitions]
+
+#include "terrainshadow.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static void randomTerrain(int columns, int rows, unsigned int seed, float amplitude, std::vector<float> & heights)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> height(0.0f, amplitude);
+	heights.resize(size_t(columns) * rows);
+	for (size_t i = 0; i < heights.size(); i++)
+		heights[i] = height(random);
+}
+
+template <typename Function>
+static double bestTime(int repetitions, Function fn)
+{
+	double best = 1e30;
+	for (int rep = 0; rep < repetitions; rep++)
+	{
+		auto t0 = std::chrono::high_resolution_clock::now();
+		fn();
+		auto t1 = std::chrono::high_resolution_clock::now();
+		best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+	}
+	return best;
+}
+
+int main(int argc, char ** argv)
+{
+	int repetitions = argc > 1 ? std::max(1, atoi(argv[1])) : 3;
+
+	struct Light
+	{
+		glm::vec3 direction;
+		bool exact;
+	};
+	const Light lights[] = {
+		{ glm::vec3(0, -1, 1), true }, //the game light
+		{ glm::vec3(0, -1, -1), true },
+		{ glm::vec3(1, -1, 0), true },
+		{ glm::vec3(-1, -0.5f, 0), true },
+		{ glm::vec3(0, -0.4f, 1), true },
+		{ glm::vec3(0, -3, 1), true },
+		{ glm::vec3(1, -1, 1), true },
+		{ glm::vec3(1, -1, -1), true },
+		{ glm::vec3(-1, -0.7f, 1), true },
+		{ glm::vec3(-1, -1, -1), true },
+		{ glm::vec3(0.4f, -1, 1), false },
+		{ glm::vec3(1, -0.8f, 0.3f), false }
+	};
+	const int checkSizes[] = { 8, 20, 33, 48 };
+	const float amplitudes[] = { 1.0f, 4.0f };
+
+	bool ok = true;
+	std::vector<float> heights;
+	std::vector<uint8_t> swept, cast;
+	printf("check against the ray cast\n");
+	for (const Light & light : lights)
+	{
+		size_t different = 0, total = 0, shadowed = 0;
+		for (int size : checkSizes)
+		{
+			for (unsigned int seed = 1; seed <= 3; seed++)
+			{
+				randomTerrain(size, size, seed * 7919 + size, amplitudes[seed % 2], heights);
+				terrainShadows(&heights[0], size, size, light.direction, swept);
+				terrainShadowsRayCast(&heights[0], size, size, light.direction, cast);
+				for (size_t i = 0; i < swept.size(); i++)
+				{
+					different += swept[i] != cast[i];
+					shadowed += cast[i];
+				}
+				total += swept.size();
+			}
+		}
+		printf("  light (%5.2f, %5.2f, %5.2f): %6zu vertices, %5.1f%% in shadow, %zu differ%s\n",
+			light.direction.x, light.direction.y, light.direction.z, total, 100.0 * shadowed / total, different,
+			light.exact ? "" : " (interpolated)");
+		if (light.exact && different > 0)
+			ok = false;
+	}
+
+	printf("compare with the original computeShadow (not required to match)\n");
+	std::vector<uint8_t> original;
+	for (const Light & light : lights)
+	{
+		size_t onlyOriginal = 0, onlySwept = 0, total = 0;
+		for (int size : checkSizes)
+		{
+			for (unsigned int seed = 1; seed <= 3; seed++)
+			{
+				randomTerrain(size, size, seed * 7919 + size, amplitudes[seed % 2], heights);
+				terrainShadows(&heights[0], size, size, light.direction, swept);
+				terrainShadowsBaseline(&heights[0], size, size, light.direction, original);
+				for (size_t i = 0; i < swept.size(); i++)
+				{
+					onlyOriginal += original[i] && !swept[i];
+					onlySwept += swept[i] && !original[i];
+				}
+				total += swept.size();
+			}
+		}
+		printf("  light (%5.2f, %5.2f, %5.2f): %6zu vertices, %5zu only in the original's shadow, %5zu only in the sweep's\n",
+			light.direction.x, light.direction.y, light.direction.z, total, onlyOriginal, onlySwept);
+	}
+	const glm::vec3 gameLight(0, -1, 1);
+	{
+		//the game terrain: 20 x 20, heights 0..1
+		const int size = 20;
+		randomTerrain(size, size, 1, 1.0f, heights);
+		terrainShadows(&heights[0], size, size, gameLight, swept);
+		terrainShadowsBaseline(&heights[0], size, size, gameLight, original);
+		printf("  game terrain, game light, row 0 first: # both in shadow, o only the original, s only the sweep\n");
+		for (int i = 0; i < size; i++)
+		{
+			printf("    ");
+			for (int j = 0; j < size; j++)
+			{
+				size_t k = size_t(i) * size + j;
+				putchar(original[k] ? (swept[k] ? '#' : 'o') : (swept[k] ? 's' : '.'));
+			}
+			putchar('\n');
+		}
+	}
+
+	printf("ray cast\n");
+	const int castSizes[] = { 16, 20, 32, 64 };
+	for (int size : castSizes)
+	{
+		randomTerrain(size, size, 1, 1.0f, heights);
+		double seconds = bestTime(size > 32 ? 1 : repetitions, [&] {
+			terrainShadowsRayCast(&heights[0], size, size, gameLight, cast);
+		});
+		printf("  %5d x %-5d %10.3f ms\n", size, size, seconds * 1000.0);
+	}
+
+	printf("horizon sweep\n");
+	const int sweepSizes[] = { 20, 64, 256, 512, 1024, 2048 };
+	const glm::vec3 otherLight(0.4f, -1, 1);
+	for (int size : sweepSizes)
+	{
+		randomTerrain(size, size, 1, 1.0f, heights);
+		double seconds = bestTime(repetitions, [&] {
+			terrainShadows(&heights[0], size, size, gameLight, swept);
+		});
+		double interpolated = bestTime(repetitions, [&] {
+			terrainShadows(&heights[0], size, size, otherLight, swept);
+		});
+		printf("  %5d x %-5d %10.3f ms, %6.2f ns per vertex (interpolated light %.3f ms)\n", size, size,
+			seconds * 1000.0, seconds * 1e9 / (double(size) * size), interpolated * 1000.0);
+	}
+	if (!ok)
+	{
+		printf("FAILED: the sweep differs for an exact light\n");
+		return EXIT_FAILURE;
+	}
+	return 0;
+}
@@ -0,0 +1,338 @@
+//Simplification benchmark and quality suite: generates synthetic meshes (subdivided icosahedron
+//spheres, noisy fractal terrains and scan-like samplings of a torus with uneven density, jitter
+//and shuffled vertex order) from ten thousand up to ten million triangles and runs
+//Grid::simplifyMesh over a range of resolutions. Every run reports the throughput, the peak heap
+//usage of the call (counted by replacing the global operator new/delete), the output size and the
+//symmetric Hausdorff and RMS distance between input and output (see meshdistance.h, one-sided
+//values included), as JSON so the numbers can be compared across versions. -quadric also runs
+//QuadricSimplifier down to the triangle count of every grid result, to compare the engines.
+//
+//usage: simplifybench [-large] [-quadric] [-o results.json] [repetitions]
+//The sizes are 10K, 100K and 1M triangles, -large adds 10M (needs a few GB of memory).
+//Progress goes to stderr, the JSON to stdout unless -o is given.
+
+#include "grid.h"
+#include "meshdistance.h"
+#include "quadricsimplifier.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+/************************************************************
+ * Heap counting
+ ************************************************************/
+namespace {
+
+std::atomic<size_t> heapInUse(0);
+std::atomic<size_t> heapPeak(0);
+const size_t ALLOCATION_HEADER = 16; //keeps the alignment malloc gives
+
+void * countedAlloc(size_t size)
+{
+	char * p = static_cast<char *>(malloc(size + ALLOCATION_HEADER));
+	if (!p)
+		throw std::bad_alloc();
+	*reinterpret_cast<size_t *>(p) = size;
+	size_t inUse = heapInUse += size;
+	size_t peak = heapPeak.load();
+	while (inUse > peak && !heapPeak.compare_exchange_weak(peak, inUse)) {}
+	return p + ALLOCATION_HEADER;
+}
+
+void countedFree(void * p)
+{
+	if (!p)
+		return;
+	char * base = static_cast<char *>(p) - ALLOCATION_HEADER;
+	heapInUse -= *reinterpret_cast<size_t *>(base);
+	free(base);
+}
+
+} // namespace
+
+void * operator new(size_t size) { return countedAlloc(size); }
+void * operator new[](size_t size) { return countedAlloc(size); }
+void * operator new(size_t size, const std::nothrow_t &) noexcept { try { return countedAlloc(size); } catch (...) { return 0; } }
+void * operator new[](size_t size, const std::nothrow_t &) noexcept { try { return countedAlloc(size); } catch (...) { return 0; } }
+void operator delete(void * p) noexcept { countedFree(p); }
+void operator delete[](void * p) noexcept { countedFree(p); }
+void operator delete(void * p, const std::nothrow_t &) noexcept { countedFree(p); }
+void operator delete[](void * p, const std::nothrow_t &) noexcept { countedFree(p); }
+
+/************************************************************
+ * Synthetic meshes
+ ************************************************************/
+
+//icosahedron with every face split into n x n triangles, projected on the unit sphere
+static void makeSphere(size_t targetTriangles, Mesh & mesh)
+{
+	const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+	const Vec3Df corners[12] = {
+		Vec3Df(-1, t, 0), Vec3Df(1, t, 0), Vec3Df(-1, -t, 0), Vec3Df(1, -t, 0),
+		Vec3Df(0, -1, t), Vec3Df(0, 1, t), Vec3Df(0, -1, -t), Vec3Df(0, 1, -t),
+		Vec3Df(t, 0, -1), Vec3Df(t, 0, 1), Vec3Df(-t, 0, -1), Vec3Df(-t, 0, 1) };
+	const int faces[20][3] = {
+		{ 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+		{ 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+		{ 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+		{ 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 } };
+	unsigned int n = std::max(1u, unsigned(std::sqrt(double(targetTriangles) / 20.0) + 0.5));
+
+	//points on shared edges and corners are found again through their weights on the corners
+	std::unordered_map<uint64_t, uint32_t> shared;
+	std::vector<uint32_t> row, previousRow;
+	for (int f = 0; f < 20; f++)
+	{
+		for (unsigned int i = 0; i <= n; i++)
+		{
+			row.clear();
+			for (unsigned int j = 0; j <= n - i; j++)
+			{
+				unsigned int weights[3] = { n - i - j, j, i };
+				uint64_t parts[3] = { 0, 0, 0 };
+				for (int k = 0; k < 3; k++)
+				{
+					if (weights[k] > 0)
+						parts[k] = uint64_t(faces[f][k] + 1) << 12 | weights[k];
+				}
+				std::sort(parts, parts + 3);
+				uint64_t key = parts[0] << 32 | parts[1] << 16 | parts[2];
+				auto found = shared.find(key);
+				if (found != shared.end())
+				{
+					row.push_back(found->second);
+					continue;
+				}
+				Vec3Df p = corners[faces[f][0]] * float(weights[0]) + corners[faces[f][1]] * float(weights[1])
+					+ corners[faces[f][2]] * float(weights[2]);
+				p.normalize();
+				row.push_back(uint32_t(mesh.vertices.size()));
+				shared[key] = row.back();
+				mesh.vertices.push_back(Vertex(p));
+			}
+			if (i > 0)
+			{
+				for (unsigned int j = 0; j + 1 < previousRow.size(); j++)
+				{
+					mesh.triangles.push_back(Triangle(previousRow[j], previousRow[j + 1], row[j]));
+					if (j + 1 < row.size())
+						mesh.triangles.push_back(Triangle(previousRow[j + 1], row[j + 1], row[j]));
+				}
+			}
+			previousRow.swap(row);
+		}
+	}
+	mesh.centerNormalsAndBounds();
+}
+
+//smoothly interpolated random lattice values, deterministic for a seed
+static float valueNoise(float x, float y, uint32_t seed)
+{
+	int xi = int(std::floor(x)), yi = int(std::floor(y));
+	float fx = x - xi, fy = y - yi;
+	auto lattice = [seed](int i, int j) {
+		uint32_t h = uint32_t(i) * 374761393u + uint32_t(j) * 668265263u + seed * 2246822519u;
+		h = (h ^ (h >> 13)) * 1274126177u;
+		return float(h ^ (h >> 16)) / 4294967295.0f;
+	};
+	float sx = fx * fx * (3.0f - 2.0f * fx), sy = fy * fy * (3.0f - 2.0f * fy);
+	float a = lattice(xi, yi) + sx * (lattice(xi + 1, yi) - lattice(xi, yi));
+	float b = lattice(xi, yi + 1) + sx * (lattice(xi + 1, yi + 1) - lattice(xi, yi + 1));
+	return a + sy * (b - a);
+}
+
+//square heightfield of fractal value noise plus a little white noise
+static void makeTerrain(size_t targetTriangles, Mesh & mesh)
+{
+	unsigned int n = std::max(2u, unsigned(std::sqrt(double(targetTriangles) / 2.0) + 1.5));
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> grain(-0.002f, 0.002f);
+	for (unsigned int y = 0; y < n; y++)
+	{
+		for (unsigned int x = 0; x < n; x++)
+		{
+			float u = float(x) / (n - 1), v = float(y) / (n - 1);
+			float height = 0.0f, amplitude = 0.25f, frequency = 4.0f;
+			for (int octave = 0; octave < 6; octave++, amplitude *= 0.5f, frequency *= 2.0f)
+				height += amplitude * valueNoise(u * frequency, v * frequency, octave);
+			mesh.vertices.push_back(Vertex(Vec3Df(2.0f * u - 1.0f, height + grain(random), 2.0f * v - 1.0f)));
+		}
+	}
+	for (unsigned int y = 0; y + 1 < n; y++)
+	{
+		for (unsigned int x = 0; x + 1 < n; x++)
+		{
+			uint32_t a = y * n + x, b = a + 1, c = a + n, d = c + 1;
+			mesh.triangles.push_back(Triangle(a, c, b));
+			mesh.triangles.push_back(Triangle(b, c, d));
+		}
+	}
+	mesh.centerNormalsAndBounds();
+}
+
+//torus sampled the way a scanner would: uneven density, jittered samples, depth noise and the
+//vertices in random order
+static void makeScan(size_t targetTriangles, Mesh & mesh)
+{
+	const double pi = 3.14159265358979323846;
+	unsigned int nv = std::max(3u, unsigned(std::sqrt(double(targetTriangles) / 4.0) + 0.5));
+	unsigned int nu = 2 * nv;
+	std::mt19937 random(11);
+	std::uniform_real_distribution<double> jitter(-0.3, 0.3);
+	std::normal_distribution<double> depth(0.0, 0.002);
+	std::vector<Vertex> samples;
+	for (unsigned int i = 0; i < nu; i++)
+	{
+		for (unsigned int j = 0; j < nv; j++)
+		{
+			//three times denser on one side of the ring than on the other
+			double s = (i + jitter(random)) / nu;
+			double u = 2.0 * pi * (s + 0.25 * std::sin(2.0 * pi * s) / pi);
+			double v = 2.0 * pi * (j + jitter(random)) / nv;
+			double r = 0.35 + depth(random);
+			samples.push_back(Vertex(Vec3Df(float((1.0 + r * std::cos(v)) * std::cos(u)), float(r * std::sin(v)),
+				float((1.0 + r * std::cos(v)) * std::sin(u)))));
+		}
+	}
+	std::vector<uint32_t> order(samples.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = uint32_t(i);
+	std::shuffle(order.begin(), order.end(), random);
+	std::vector<uint32_t> position(samples.size());
+	mesh.vertices.resize(samples.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		mesh.vertices[i] = samples[order[i]];
+		position[order[i]] = uint32_t(i);
+	}
+	for (unsigned int i = 0; i < nu; i++)
+	{
+		for (unsigned int j = 0; j < nv; j++)
+		{
+			uint32_t a = position[i * nv + j], b = position[i * nv + (j + 1) % nv];
+			uint32_t c = position[((i + 1) % nu) * nv + j], d = position[((i + 1) % nu) * nv + (j + 1) % nv];
+			mesh.triangles.push_back(Triangle(a, b, c));
+			mesh.triangles.push_back(Triangle(b, d, c));
+		}
+	}
+	mesh.centerNormalsAndBounds();
+}
+
+/************************************************************
+ * Benchmark
+ ************************************************************/
+
+struct Generator
+{
+	const char * name;
+	void (*make)(size_t, Mesh &);
+};
+
+int main(int argc, char ** argv)
+{
+	bool large = false, quadric = false;
+	const char * outputFile = 0;
+	int repetitions = 3;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-large") == 0)
+			large = true;
+		else if (strcmp(argv[i], "-quadric") == 0)
+			quadric = true;
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			outputFile = argv[++i];
+		else
+			repetitions = std::max(1, atoi(argv[i]));
+	}
+	FILE * out = outputFile ? fopen(outputFile, "w") : stdout;
+	if (!out)
+	{
+		fprintf(stderr, "cannot write %s\n", outputFile);
+		return EXIT_FAILURE;
+	}
+
+	const Generator generators[] = { { "sphere", makeSphere }, { "terrain", makeTerrain }, { "scan", makeScan } };
+	std::vector<size_t> sizes = { 10000, 100000, 1000000 };
+	if (large)
+		sizes.push_back(10000000);
+	const unsigned int resolutions[] = { 16, 32, 64, 128, 256 };
+
+	fprintf(out, "{\n  \"benchmark\": \"simplifybench\",\n  \"threads\": %u,\n  \"repetitions\": %d,\n  \"runs\": [",
+		hardwareThreads(), repetitions);
+	bool first = true;
+	for (const Generator & generator : generators)
+	{
+		for (size_t size : sizes)
+		{
+			Mesh mesh;
+			generator.make(size, mesh);
+			fprintf(stderr, "%s: %zu triangles, %zu vertices\n", generator.name, mesh.triangles.size(), mesh.vertices.size());
+			double diagonal = std::sqrt(3.0) * mesh.bbEdgeSize;
+			TriangleBvh referenceBvh;
+			referenceBvh.build(mesh.vertices, mesh.triangles);
+
+			for (unsigned int r : resolutions)
+			{
+				//the quadric engine gets the triangle count the grid reached, so both are compared
+				//at the same output size
+				size_t targetTriangles = 0;
+				for (int engine = 0; engine < (quadric ? 2 : 1); engine++)
+				{
+					Grid grid;
+					QuadricSimplifier simplifier;
+					Mesh simplified;
+					double best = 1e30;
+					size_t peak = 0;
+					for (int rep = 0; rep < repetitions; rep++)
+					{
+						simplified = Mesh();
+						size_t baseline = heapInUse.load();
+						heapPeak = baseline;
+						auto t0 = std::chrono::high_resolution_clock::now();
+						if (engine == 0)
+							simplified = grid.simplifyMesh(mesh, r);
+						else
+							simplified = simplifier.simplifyMesh(mesh, targetTriangles);
+						auto t1 = std::chrono::high_resolution_clock::now();
+						best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+						peak = std::max(peak, heapPeak.load() - baseline);
+					}
+					targetTriangles = simplified.triangles.size();
+
+					//simplifyMesh recenters and rescales its output, so the error is measured on the
+					//same result before that step, in the frame of the input
+					Mesh unscaled = engine == 0 ? grid.clusterMesh(mesh, r) : simplifier.collapseMesh(mesh, targetTriangles);
+					MeshError error = measureError(mesh, unscaled, 0, &referenceBvh);
+
+					const char * engineName = engine == 0 ? "grid" : "quadric";
+					fprintf(stderr, "  r %4u %-7s: %8.2f ms, %7.1f Mtris/s, peak %7.1f MB, %9zu triangles, hausdorff %.5f, rms %.5f\n",
+						r, engineName, best * 1000.0, mesh.triangles.size() / best * 1e-6, peak / 1048576.0,
+						simplified.triangles.size(), error.hausdorff, error.rms);
+					fprintf(out, "%s\n    { \"mesh\": \"%s\", \"engine\": \"%s\", \"input_triangles\": %zu, \"input_vertices\": %zu, \"r\": %u, "
+						"\"seconds\": %.6f, \"triangles_per_second\": %.0f, \"peak_bytes\": %zu, "
+						"\"output_triangles\": %zu, \"output_vertices\": %zu, "
+						"\"hausdorff\": %.7g, \"rms\": %.7g, \"hausdorff_relative\": %.7g, \"rms_relative\": %.7g, "
+						"\"forward_max\": %.7g, \"forward_rms\": %.7g, \"backward_max\": %.7g, \"backward_rms\": %.7g }",
+						first ? "" : ",", generator.name, engineName, mesh.triangles.size(), mesh.vertices.size(), r,
+						best, mesh.triangles.size() / best, peak, simplified.triangles.size(), simplified.vertices.size(),
+						error.hausdorff, error.rms, error.hausdorff / diagonal, error.rms / diagonal,
+						error.forward.max, error.forward.rms, error.backward.max, error.backward.rms);
+					first = false;
+				}
+			}
+		}
+	}
+	fprintf(out, "\n  ]\n}\n");
+	if (outputFile)
+		fclose(out);
+	return 0;
+}
@@ -0,0 +1,128 @@
+//Benchmark for the procedural terrain (terraingenerator.h): checks that chunks of any size give
+//the same rows as the whole terrain made at once (heights, normals, and the shadows of the
+//whole sweep for lights along the rows, the columns and the diagonals), times the generation of
+//one chunk for sizes up to 2048 x 512, then scrolls through TerrainGenerator like the game does,
+//one row per frame, and reports what nextRow() costs the main thread: it should not depend on
+//the chunk size, the worker makes the chunks ahead.
+//
+//usage: terrainbench [repetitions]
+
+#include "terraingenerator.h"
+#include "terrainshadow.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+template <typename Function>
+static double bestTime(int repetitions, Function fn)
+{
+	double best = 1e30;
+	for (int rep = 0; rep < repetitions; rep++)
+	{
+		auto t0 = std::chrono::high_resolution_clock::now();
+		fn();
+		auto t1 = std::chrono::high_resolution_clock::now();
+		best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+	}
+	return best;
+}
+
+int main(int argc, char ** argv)
+{
+	int repetitions = argc > 1 ? std::max(1, atoi(argv[1])) : 3;
+	bool ok = true;
+
+	printf("check the chunks against the whole terrain\n");
+	const glm::vec3 lights[] = {
+		glm::vec3(0, -1, 1), //the game light
+		glm::vec3(0, -0.3f, -1),
+		glm::vec3(1, -0.5f, 0),
+		glm::vec3(-1, -0.4f, 1),
+		glm::vec3(1, -0.2f, -1)
+	};
+	const int columns = 37, rows = 300;
+	std::vector<float> heights(size_t(columns) * rows);
+	for (int i = 0; i < rows; i++)
+		terrainRowHeights(1, i, columns, &heights[size_t(i) * columns]);
+	for (const glm::vec3 & light : lights)
+	{
+		std::vector<uint8_t> shadowed;
+		terrainShadows(&heights[0], columns, rows, light, shadowed, false);
+		const int chunkSizes[] = { 1, 7, 64 };
+		std::vector<terrainVertex> first;
+		size_t wrong = 0;
+		for (int chunkRows : chunkSizes)
+		{
+			TerrainSettings settings = { columns, chunkRows, 1, light };
+			std::vector<terrainVertex> all;
+			TerrainChunk chunk;
+			//the last row of the whole terrain has no row after it for its normals
+			for (int index = 0; (index + 1) * chunkRows < rows; index++)
+			{
+				generateTerrainChunk(settings, index, chunk);
+				all.insert(all.end(), chunk.vertices.begin(), chunk.vertices.end());
+			}
+			for (size_t k = 0; k < all.size(); k++)
+			{
+				bool sameHeight = all[k].pos.y == heights[k];
+				bool sameShadow = (all[k].shadow.x < 0.75f) == (shadowed[k] != 0);
+				bool sameNormal = first.empty() || k >= first.size() || glm::length(all[k].normal - first[k].normal) < 1e-5f;
+				wrong += !sameHeight || !sameShadow || !sameNormal;
+			}
+			if (first.empty())
+				first = all;
+		}
+		printf("  light (%5.2f, %5.2f, %5.2f): %zu vertices differ\n", light.x, light.y, light.z, wrong);
+		ok = ok && wrong == 0;
+	}
+
+	printf("one chunk\n");
+	struct Size
+	{
+		int columns, rows;
+	};
+	const Size sizes[] = { { 20, 20 }, { 64, 64 }, { 256, 256 }, { 1024, 256 }, { 2048, 512 } };
+	for (const Size & size : sizes)
+	{
+		TerrainSettings settings = { size.columns, size.rows, 1, lights[0] };
+		TerrainChunk chunk;
+		double seconds = bestTime(repetitions, [&] { generateTerrainChunk(settings, 3, chunk); });
+		printf("  %5d x %-4d %10.3f ms, %6.1f ns per vertex\n", size.columns, size.rows, seconds * 1000.0,
+			seconds * 1e9 / (double(size.columns) * size.rows));
+	}
+
+	printf("scrolling, one row per frame of 2 ms\n");
+	for (const Size & size : sizes)
+	{
+		TerrainSettings settings = { size.columns, size.rows, 1, lights[0] };
+		TerrainGenerator generator(settings);
+		const int frames = std::max(3 * size.rows, 200);
+		double worst = 0.0, total = 0.0;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			auto t0 = std::chrono::high_resolution_clock::now();
+			generator.nextRow();
+			auto t1 = std::chrono::high_resolution_clock::now();
+			double seconds = std::chrono::duration<double>(t1 - t0).count();
+			//the first chunk is waited for, like the game does at startup
+			if (frame >= size.rows)
+			{
+				worst = std::max(worst, seconds);
+				total += seconds;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+		printf("  chunks of %5d x %-4d nextRow %8.3f us on average, %8.3f us at worst\n", size.columns,
+			size.rows, total * 1e6 / (frames - size.rows), worst * 1e6);
+	}
+
+	if (!ok)
+	{
+		printf("FAILED: the chunks differ from the whole terrain\n");
+		return EXIT_FAILURE;
+	}
+	return 0;
+}